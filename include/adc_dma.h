@@ -0,0 +1,34 @@
+// =============================
+// Continuous ADC (I2S DMA) Acquisition
+// =============================
+// The ESP32's I2S0 peripheral can clock ADC1 directly into DMA buffers.
+// The ADC then streams at tens to hundreds of kHz with no CPU involvement;
+// the acquisition task only has to decimate finished blocks.
+//
+// With several channels selected (channels.h) the ADC's pattern table holds
+// one entry per channel, so the hardware scans them in turn and the stream
+// rate is shared between them. Every DMA word keeps its channel number in
+// bits 12-15 for the reader to demultiplex.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define FAST_MIN_STREAM_RATE 20000   // Lowest I2S ADC clock that runs reliably (Hz)
+#define FAST_MAX_STREAM_RATE 500000  // Highest ADC stream rate used by fast mode (Hz)
+#define ADC_DMA_BUF_LEN 1024         // Samples per DMA buffer
+#define ADC_DMA_BUF_COUNT 4          // Number of DMA buffers
+
+bool adcDmaStart(uint32_t streamRate);                       // Install I2S0 in ADC mode and start scanning channelList (total conversion rate)
+size_t adcDmaRead(uint16_t *raw, size_t maxSamples, uint32_t timeoutMs); // Read up to maxSamples DMA words; returns count
+uint32_t adcDmaOverflows();                                  // DMA buffers dropped because they were not read in time
+void adcDmaStop();                                           // Stop streaming and release I2S0 / ADC1
+
+// Fields of one DMA word
+inline uint16_t adcDmaCode(uint16_t word) {
+    return word & 0x0FFF;   // 12-bit ADC code
+}
+
+inline uint8_t adcDmaChannel(uint16_t word) {
+    return word >> 12;      // ADC1 channel it was converted from
+}
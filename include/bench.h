@@ -0,0 +1,30 @@
+// =============================
+// On-Device Benchmarks
+// =============================
+// 'bench' measures the figures that decide how well a build records and
+// replays, and prints them as machine-readable lines so a host can keep a
+// baseline per release and flag regressions (tools/bench.py):
+//
+//   BENCH,begin,<version>
+//   BENCH,<metric>,<value>,<unit>
+//   BENCH,end
+//
+// Metrics: the cost of one precise-mode reading for every power-of-two
+// 'samples' setting, the highest rate the sampler sustains with the current
+// settings, replay feeder jitter, export encoding throughput, and the
+// DAC1 -> ADC loopback error (GPIO25 wired to GPIO36). Metrics that cannot
+// run are reported as "skipped" with a reason instead of a value.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define BENCH_READS 16              // Readings timed per 'samples' setting
+#define BENCH_RATE_RUN_MS 300       // Length of each sustained-rate trial
+#define BENCH_RATE_TRIALS 8         // Rate trials before giving up
+#define BENCH_REPLAY_SAMPLES 500    // Synthetic ramp replayed for the jitter test
+#define BENCH_REPLAY_RATE 1000      // ...at this rate (Hz)
+#define BENCH_LOOPBACK_STEP 16      // DAC code step of the loopback sweep
+#define BENCH_LOOPBACK_MIN_V 1.0    // Full-scale reading below this = GPIO25 not wired to the input
+
+void runBenchmarks();   // Takes a few seconds; refuses while recording or replaying, and leaves a recording in RAM untouched
@@ -0,0 +1,55 @@
+// =============================
+// Lookup-Table Calibration
+// =============================
+// A raw-code -> sample table is built once from the eFuse characterisation
+// (adc_chars), with the measured ground offset and any user calibration
+// points folded in. Converting a reading is then a table load plus a linear
+// interpolation for the fractional bits, instead of a call into
+// esp_adc_cal_raw_to_voltage() per sample.
+//
+// The ground offset from 'calibrate' is treated as a calibration point at 0 V.
+// User calibration points ('calpoint <V>') correct the ESP32 ADC's
+// nonlinearity: at each point the difference between the known voltage and
+// the table is measured, and the correction is interpolated linearly between
+// points (held constant beyond the first and last).
+//
+// The table is built from the first recorded channel. Every other channel
+// gets its own ground offset on top of it (channelOffsetUnits), measured by
+// 'calibrate' with all inputs grounded, since the ADC1 inputs do not share
+// exactly the same offset.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define MAX_CAL_POINTS 8     // User calibration points kept
+#define CAL_POINT_SAMPLES 256 // Raw reads averaged for each calibration point
+
+extern sample_t calLut[ADC_MAX_CODE + 2]; // Sample value for every raw code (+1 guard entry for interpolation)
+extern int16_t channelOffsetUnits[MAX_CHANNELS]; // Ground offset of each slot relative to slot 0 (0 for slot 0)
+
+void buildCalibrationLut();                        // Rebuild calLut from adc_chars, the ground point and the user points
+void setGroundCalibration(uint32_t raw);           // Record the raw code (<< RAW_FRAC_BITS) read at 0 V; updates adcOffset
+void setChannelOffset(int slot, uint32_t raw);     // Same for another slot (call after setGroundCalibration)
+void clearChannelOffsets();                        // Forget the per-slot offsets (after changing channels)
+bool addCalibrationPoint(float volts);             // Measure the input (held at `volts`) and add a correction point
+void clearCalibrationPoints();                     // Remove all user points
+void printCalibrationPoints();                     // List the user points and their corrections
+
+// Convert an (averaged) raw ADC value with RAW_FRAC_BITS fractional bits to a
+// calibrated, offset-corrected sample
+inline sample_t rawToSample(uint32_t raw) {
+    uint32_t code = raw >> RAW_FRAC_BITS;
+    if (code >= ADC_MAX_CODE) return calLut[ADC_MAX_CODE];
+    uint32_t frac = raw & ((1 << RAW_FRAC_BITS) - 1);
+    int32_t low = calLut[code];
+    return (sample_t)(low + (((int32_t)calLut[code + 1] - low) * (int32_t)frac >> RAW_FRAC_BITS));
+}
+
+// rawToSample() for one channel slot: also removes that slot's own offset,
+// which may be either side of slot 0's
+inline sample_t rawToChannelSample(uint32_t raw, int slot) {
+    int32_t units = (int32_t)rawToSample(raw) - channelOffsetUnits[slot];
+    return units < 0 ? 0 : units > UINT16_MAX ? UINT16_MAX : (sample_t)units;
+}
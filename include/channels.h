@@ -0,0 +1,27 @@
+// =============================
+// Multi-Channel Input Selection
+// =============================
+// Up to MAX_CHANNELS ADC1 inputs (GPIO32-39) can be recorded together. Each
+// sample period then produces one frame: one sample per channel, stored
+// interleaved in voltageBuffer (frame f, slot s at [f * channelCount + s]),
+// so sampleCount counts samples and frameCount() counts sample periods.
+//
+// Slots are kept in ascending ADC1 channel order, which lets a recording
+// file describe its channels with a single bitmask. Precise mode reads the
+// channels one after another each tick; fast mode loads them into the
+// I2S ADC pattern table so the hardware scans them (see adc_dma.h).
+//
+// Statistics, triggers, streaming and record-to-file follow the first
+// channel only, so the multi-channel path is limited to RAM recordings.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+int channelGpio(adc1_channel_t channel);              // GPIO pin of an ADC1 channel
+bool gpioChannel(int gpio, adc1_channel_t &channel);  // ADC1 channel on a GPIO; false if it has none
+bool setChannels(const adc1_channel_t *channels, int count); // Select the inputs (any order, no duplicates)
+uint8_t channelMask();                                // Bit n set = ADC1 channel n is recorded
+bool setChannelMask(uint8_t mask);                    // Select the inputs from a channelMask()
+void printChannels();                                 // "GPIO36, GPIO39" on one line (no newline)
@@ -0,0 +1,39 @@
+// =============================
+// Serial Command Parser
+// =============================
+// Commands are collected byte by byte into a fixed line buffer, so reading
+// them never blocks loop() and never touches the heap. Each input (the
+// serial port, a network client) has its own CommandLine. A finished line is
+// lower-cased and split into whitespace-separated tokens in place, and the
+// first token is looked up in a table of Command entries.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define CMD_LINE_MAX 96     // Longest accepted command line (characters)
+#define CMD_MAX_ARGS 10     // Tokens per line, including the command name ("channels" + 8 pins)
+
+// Command handler: argv[0] is the command name, argv[1..argc-1] its arguments
+typedef void (*CommandHandler)(int argc, char **argv);
+
+// One entry in a command table
+struct Command {
+    const char *name;         // Command word
+    const char *alias;        // Alternative word (nullptr if none)
+    CommandHandler handler;
+};
+
+// Line being received from one input
+struct CommandLine {
+    char buffer[CMD_LINE_MAX + 1];
+    size_t length = 0;
+    bool overflowed = false;    // Current line was too long; discard it at the newline
+};
+
+char *commandRead(CommandLine &line, Stream &input); // Read pending bytes; returns a complete line (valid until the next call) or nullptr
+char *commandPoll();                       // commandRead() on Serial
+int commandTokenize(char *line, char **argv, int maxArgs); // Split in place; returns the token count
+bool commandDispatch(const Command *table, size_t count, char *line); // false if no entry matches
+bool parseInteger(const char *text, long &value); // Whole-token decimal integer
+bool parseNumber(const char *text, float &value); // Whole-token decimal number
@@ -0,0 +1,77 @@
+// =============================
+// Compressed Recording
+// =============================
+// With 'compress on', recordings are stored losslessly as a byte stream in
+// the sample arena instead of one sample_t per sample. Each token is a
+// LEB128 varint whose low bit selects its meaning:
+//
+//   (zigzag(delta) << 1) | 0   - next sample = previous sample + delta
+//   (run << 1) | 1             - next `run` samples repeat the previous one
+//
+// A slow signal whose samples move by less than ±32 units (3.2 mV) costs one
+// byte per sample, and a flat stretch of up to 63 samples costs one byte in
+// total. The previous sample starts at 0, so the first token is the first
+// sample itself.
+//
+// Compressed data can only be read in order, so everything that reads the
+// buffer goes through SampleReader, which handles both storage formats.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define COMPRESS_MAX_RUN 8191   // Longest run in one token (keeps run tokens at 2 bytes)
+#define COMPRESS_RESERVE 6      // Worst case bytes one append can emit (pending run + delta token)
+
+extern bool compressionEnabled; // 'compress on|off': format used by the next recording
+extern bool storageCompressed;  // Format of what is currently in voltageBuffer
+
+void compressBegin();                 // Start a new compressed recording in voltageBuffer
+bool compressAppend(sample_t sample); // Acquisition path: false (nothing stored) once the arena is full
+bool compressHasRoom(int samples);    // True if `samples` appends are sure to fit (whole multi-channel frames)
+void compressFlush();                 // Emit a pending run; call after the last append
+uint32_t compressedBytes();           // Arena bytes used by the current recording (either format)
+float compressionRatio();             // Uncompressed size / stored size (1.0 when uncompressed)
+
+// Sequential reader over voltageBuffer in whichever format it holds
+struct SampleReader {
+    uint32_t index;     // Samples returned so far
+    uint32_t offset;    // Compressed: next byte in the arena
+    uint32_t run;       // Compressed: repeats of `value` still to return
+    sample_t value;     // Compressed: last decoded sample
+
+    void begin() {
+        index = 0;
+        offset = 0;
+        run = 0;
+        value = 0;
+    }
+
+    // Next sample; only call while index < sampleCount
+    sample_t next() {
+        if (!storageCompressed) return voltageBuffer[index++];
+        index++;
+        if (run > 0) {
+            run--;
+            return value;
+        }
+        const uint8_t *bytes = (const uint8_t *)voltageBuffer;
+        uint32_t token = 0;
+        int shift = 0;
+        uint8_t b;
+        do {
+            b = bytes[offset++];
+            token |= (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        if (token & 1) {
+            run = (token >> 1) - 1; // This call returns the first repeat
+        } else {
+            uint32_t zigzag = token >> 1;
+            int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            value = (sample_t)(value + delta);
+        }
+        return value;
+    }
+};
@@ -0,0 +1,23 @@
+// =============================
+// Console Output
+// =============================
+// Every human-readable message goes through `console` rather than Serial, so
+// it can also be sent to a remote client (net.h): a command typed over the
+// network gets the same replies as one typed on USB. Binary frames
+// (frame.h) are unaffected and always go to Serial only.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+class Console : public Print {
+public:
+    using Print::write;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    void setMirror(Print *output) { mirror = output; } // Also copy output here (nullptr = Serial only)
+private:
+    Print *mirror = nullptr;
+};
+
+extern Console console;
@@ -0,0 +1,26 @@
+// =============================
+// Compile-Time Math
+// =============================
+// constexpr sine and cosine (Taylor series after range reduction), so filter
+// coefficient tables can be generated by the compiler instead of being pasted
+// in as literals or computed at startup.
+// =============================
+#pragma once
+
+static constexpr double kPi = 3.14159265358979323846;
+
+static constexpr double constSin(double x) {
+    while (x > kPi) x -= 2 * kPi;
+    while (x < -kPi) x += 2 * kPi;
+    double term = x;
+    double sum = x;
+    for (int i = 1; i < 12; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+static constexpr double constCos(double x) {
+    return constSin(x + kPi / 2);
+}
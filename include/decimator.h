@@ -0,0 +1,32 @@
+// =============================
+// Decimation Filters (Fast Mode)
+// =============================
+// Turns the raw ADC stream from adc_dma.h into output samples at the user's
+// rate. Outputs are raw ADC codes with RAW_FRAC_BITS fractional bits, so the
+// extra resolution gained by filtering survives until calibration.
+//
+//   box - boxcar average of D stream samples (the classic oversampling)
+//   cic - 3rd-order CIC decimating by D: much better alias rejection, adds only
+//         integer adds per stream sample
+//   fir - CIC decimating by D/2 followed by a half-band FIR decimating by 2
+//         (coefficients generated at compile time), for a flat passband and
+//         a sharp cutoff just below the output Nyquist frequency
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+enum FilterType {
+    FILTER_BOX,
+    FILTER_CIC,
+    FILTER_FIR
+};
+
+#define CIC_ORDER 3          // CIC integrator/comb stages
+#define HALFBAND_TAPS 31     // Half-band FIR length (4k - 1)
+
+const char *filterName(FilterType type);
+void decimatorBegin(FilterType type, uint32_t decimation); // Reset every slot's filter; decimation must be even for FILTER_FIR
+// Filter `count` raw 12-bit codes of one channel slot (each slot keeps its own
+// state); writes up to maxOut outputs (raw codes << RAW_FRAC_BITS) and returns how many
+size_t decimatorProcess(int slot, const uint16_t *raw, size_t count, uint32_t *out, size_t maxOut);
@@ -0,0 +1,20 @@
+// =============================
+// Bulk Binary Export
+// =============================
+// 'dump' writes the whole recording in one shot as binary frames (see
+// frame.h): a header with everything needed to interpret the samples, the
+// samples themselves in large data frames, and an end frame with a checksum
+// over all sample bytes. No pagination, no printf formatting. Multi-channel
+// recordings are sent as stored (interleaved frames); the header lists the
+// channels so the host can split them into one column each. 'range' sends
+// just a slice of the recording the same way; the header says which frame
+// it starts at, and data frame indices count from there.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define DUMP_FRAME_SAMPLES 500   // Samples per data frame (1006-byte payload)
+
+void dumpBuffer();  // Send voltageBuffer[0..sampleCount) as a framed binary blob
+void dumpFrames(uint32_t firstFrame, uint32_t frames); // Same for frames [firstFrame, firstFrame + frames) only
@@ -0,0 +1,46 @@
+// =============================
+// Min/Max Envelope Pyramid
+// =============================
+// A multi-resolution min/max summary of voltageBuffer, kept up to date by
+// the acquisition task as frames are stored, so 'overview' can send an
+// N-point envelope of any recording without reading its samples.
+//
+// Level 0 holds the min and max of each block of `blockFrames` frames, per
+// channel. Each level above merges pairs of the one below, up to a single
+// entry for the whole capacity. Like the timing stamps, the block size grows
+// with the arena (a power of two), so the pyramid always fits in
+// ENVELOPE_ENTRIES entries: adding a frame costs two compares per channel,
+// plus one merge per level when a block completes (amortised O(1)).
+//
+// Any run of whole blocks is answered from at most two entries per level.
+// Overview points are snapped to block boundaries, so each point's min/max
+// are exact for the frames it reports. When points are narrower than a
+// block, the samples are scanned instead. Triggered captures and loaded
+// recordings get their pyramid rebuilt in one pass (samplerRebuildStats()).
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define ENVELOPE_ENTRIES 2048           // Min/max pairs in the pyramid, all channels and levels (8 KB)
+#define ENVELOPE_MAX_POINTS 10000       // Most points one 'overview' returns
+
+struct EnvelopeEntry {
+    sample_t min;
+    sample_t max;
+};
+
+// Acquisition side
+void envelopeBegin(uint32_t frameCapacity, int channels); // Empty pyramid for up to frameCapacity frames
+void envelopeAdd(const sample_t *frame);                  // One stored frame (channels samples)
+void envelopeRebuild();                                   // Recompute from voltageBuffer (not while recording)
+
+// Query side (loop())
+uint32_t envelopeFrames();      // Frames summarised so far
+uint32_t envelopeBlockFrames(); // Frames per level-0 block
+// Min/max of frames [first, first + frames) of one channel slot; `first`
+// and `frames` must be multiples of envelopeBlockFrames() unless the range
+// ends at envelopeFrames() with the capture stopped
+EnvelopeEntry envelopeRange(uint32_t first, uint32_t frames, int slot);
+bool sendOverview(uint32_t points); // FRAME_OVERVIEW_* frames; false if there is nothing to send
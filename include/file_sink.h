@@ -0,0 +1,55 @@
+// =============================
+// Record-to-File Sink
+// =============================
+// Records straight into a recording file (storage.h format) instead of
+// voltageBuffer, so the capture length is bounded by the file system rather
+// than RAM. loop() moves samples from liveRing into a ring of chunk buffers
+// (blocks); each full block is handed to a writer task, which writes it
+// while loop() fills the next one. If every block is still waiting on the
+// file system when the current one fills, that block is discarded and
+// counted, so liveRing keeps draining and a slow card costs whole blocks at
+// known positions (the next chunk's first index shows the gap) rather than
+// scattered samples. liveRing holds about a second at 1 kHz, so loop() must
+// not be held up for long while a sink is active (main.cpp refuses 'show'
+// and 'range' until the recording stops).
+//
+// FileSinkConfig picks the buffering and flush policy per target: internal
+// flash uses two blocks and flushes every block; the SD card (sd_card.h)
+// uses three, writes sector-aligned padded blocks and flushes less often,
+// since every flush rewrites FAT and directory sectors.
+//
+// On the ESP32 a write to internal flash pauses the other core's cache, so
+// the acquisition task can stall for the length of a block erase. This is
+// fine at the default rates, but any periods it misses are reported by
+// samplerMissedTicks() as usual.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define FILE_SINK_MAX_BUFFERS 4         // Most chunk buffers a sink can use
+#define FILE_SINK_TASK_STACK 4096       // Writer task stack size (bytes)
+#define FILE_SINK_TASK_PRIORITY 3       // Above loopTask (1) so full buffers are written promptly
+#define FILE_SINK_CORE 0                // Writer runs next to loop(), away from the acquisition task
+
+struct FileSinkConfig {
+    uint8_t buffers;        // Chunk buffers: 2 = double, 3 = triple buffering (max FILE_SINK_MAX_BUFFERS)
+    uint16_t syncBlocks;    // Flush the file every N blocks (0 = only when the recording ends)
+    bool aligned;           // Pad the header to SD_SECTOR_BYTES and every block to a full chunk
+};
+
+#define SD_SECTOR_BYTES 512
+#define FLASH_SINK_CONFIG { 2, 1, false }   // LittleFS: commit every 4 KB block
+
+bool fileSinkBegin(fs::FS &fs, const char *path, const FileSinkConfig &config); // Create the file and start accepting samples
+void fileSinkService();       // Call from loop(): move queued samples into chunk buffers
+void fileSinkEnd();           // Write the last partial chunk, finish the header and close the file
+bool fileSinkActive();        // True between fileSinkBegin() and fileSinkEnd()
+bool fileSinkFailed();        // A write failed (file system full); later samples are discarded
+uint32_t fileSinkWritten();   // Samples queued for writing
+uint32_t fileSinkDropped();   // Samples lost (liveRing overflow or discarded blocks)
+uint32_t fileSinkBlocks();        // Blocks written
+uint32_t fileSinkDroppedBlocks(); // Blocks discarded because every buffer was still being written
+uint32_t fileSinkSyncs();         // File flushes so far
+uint32_t fileSinkMaxWriteMicros(); // Slowest block write (including its flush)
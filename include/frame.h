@@ -0,0 +1,59 @@
+// =============================
+// Binary Serial Framing
+// =============================
+// Machine-readable output (streaming, and later bulk export) is sent as
+// self-delimiting frames so a host can pick them out of the serial stream
+// even when human-readable text is interleaved:
+//
+//   0xA5 0x5A | type (u8) | length (u16) | payload (length bytes) | crc16 (u16)
+//
+// All multi-byte fields are little-endian. The CRC is CRC-16/CCITT-FALSE
+// (poly 0x1021, init 0xFFFF) over type, length and payload.
+// tools/decode_stream.py is the matching host-side decoder.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define FRAME_SYNC_0 0xA5
+#define FRAME_SYNC_1 0x5A
+#define FRAME_FORMAT_VERSION 3     // Bumped whenever a payload layout changes
+#define FRAME_MAX_PAYLOAD 1024     // Largest payload any frame may carry (bytes)
+
+// Frame types
+enum FrameType : uint8_t {
+    FRAME_STREAM_START = 0x01,  // version u8, units_per_volt u16, sample_rate u32, adc_samples u16, mode u8
+    FRAME_STREAM_DATA  = 0x02,  // seq u16, first_index u32, first_time_us u32, count u16, samples u16[count]
+    FRAME_STREAM_END   = 0x03,  // samples_sent u32, samples_dropped u32
+    FRAME_EVENT        = 0x04,  // index u32, time_us u32, type u8, value u16 (see watch.h)
+    FRAME_DUMP_HEADER  = 0x10,  // version u8, units_per_volt u16, sample_rate u32, count u32, adc_offset u16, adc_samples u16, mode u8, channels u8, channel_mask u8, first_frame u32
+    FRAME_DUMP_DATA    = 0x11,  // first_index u32, count u16, samples u16[count]
+    FRAME_DUMP_END     = 0x12,  // count u32, crc16 of all sample bytes u16
+    FRAME_OVERVIEW_HEADER = 0x20, // version u8, units_per_volt u16, sample_rate u32, frames u32, points u16, channels u8, channel_mask u8, block_frames u32 (0 = scanned)
+    FRAME_OVERVIEW_DATA   = 0x21, // first_point u16, count u16, then per point: first_frame u32, (min u16, max u16)[channels]
+    FRAME_OVERVIEW_END    = 0x22  // points u16
+};
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t length); // CRC-16/CCITT-FALSE (start with 0xFFFF)
+void sendFrame(uint8_t type, const uint8_t *payload, uint16_t length);  // Write one complete frame to Serial
+size_t encodeFrame(uint8_t *out, uint8_t type, const uint8_t *payload, uint16_t length); // Same frame into memory (FRAME_BYTES(length)); returns its size
+
+#define FRAME_OVERHEAD 7                     // Sync, type, length and CRC
+#define FRAME_BYTES(length) ((length) + FRAME_OVERHEAD)
+
+// Little-endian field packing; each returns the position after the field
+inline uint8_t *putU8(uint8_t *p, uint8_t v) {
+    *p++ = v;
+    return p;
+}
+
+inline uint8_t *putU16(uint8_t *p, uint16_t v) {
+    *p++ = v & 0xFF;
+    *p++ = v >> 8;
+    return p;
+}
+
+inline uint8_t *putU32(uint8_t *p, uint32_t v) {
+    p = putU16(p, v & 0xFFFF);
+    return putU16(p, v >> 16);
+}
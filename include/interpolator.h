@@ -0,0 +1,73 @@
+// =============================
+// Replay Interpolation and Dither
+// =============================
+// Turns recorded samples into DAC codes at the replay's DAC clock. The caller
+// steps a 32-bit fraction through each sample interval, once per DAC update
+// (1 / repeat of an interval at normal speed, more or less for 'replay speed'),
+// and the interpolator evaluates the curve at those points. Everything runs in
+// fixed point, one run of DAC updates at a time, so the feeder task keeps up
+// at REPLAY_INTERP_DAC_RATE on both DACs.
+//
+//   hold   - each sample is held for `repeat` updates (the classic staircase)
+//   linear - straight lines between neighbouring samples (one sample of delay)
+//   fir    - band-limited interpolation: an INTERP_TAPS-tap Blackman-windowed
+//            sinc split into INTERP_PHASES phases (generated at compile time),
+//            with linear blending between adjacent phases for any `repeat`
+//            (INTERP_TAPS / 2 samples of delay)
+//
+// Interpolated values keep 8 fractional bits below the DAC code, which the
+// dither stage spends before the 8-bit DAC:
+//
+//   off    - round to the nearest code
+//   tpdf   - add triangular dither of +-1 code, so slow signals average to
+//            their true level instead of sticking to a code
+//   shaped - TPDF plus first-order error feedback, which pushes the
+//            quantisation noise up towards the DAC clock where an RC filter
+//            on the output removes it
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+enum InterpMode : uint8_t {
+    INTERP_HOLD,
+    INTERP_LINEAR,
+    INTERP_FIR
+};
+
+enum DitherMode : uint8_t {
+    DITHER_OFF,
+    DITHER_TPDF,
+    DITHER_SHAPED
+};
+
+#define INTERP_TAPS 8       // Input samples under the FIR at any time
+#define INTERP_PHASES 32    // Coefficient sets per sample interval
+
+extern InterpMode interpMode;   // Used by the next replay
+extern DitherMode ditherMode;
+
+const char *interpName(InterpMode mode);
+const char *ditherName(DitherMode mode);
+
+// One DAC output's history, phase and dither state
+struct InterpState {
+    InterpMode mode;
+    DitherMode dither;
+    int32_t history[INTERP_TAPS];   // Most recent input samples, oldest first
+    int pending;                    // Pushes still to swallow before output starts (filter delay)
+    bool primed;                    // History holds the first sample
+    int32_t error;                  // Quantisation error fed back by DITHER_SHAPED (Q8 codes)
+    uint32_t noise;                 // xorshift32 state for the dither
+};
+
+void interpBegin(InterpState &state, InterpMode mode, DitherMode dither, uint32_t seed);
+// Add the next recorded sample; true when it completes an interval to output
+bool interpPush(InterpState &state, sample_t sample);
+int interpDelay(const InterpState &state); // Pushes of the last sample needed at the end to output every interval
+// DAC codes for `count` updates of the current interval, starting `position` of the
+// way through it and advancing `step` per update (both 32-bit fractions of the
+// interval; position + (count - 1) * step must stay inside it), written as the
+// high byte of out[0], out[stride], ...
+void interpRender(InterpState &state, uint32_t position, uint32_t step, size_t count, uint16_t *out, size_t stride);
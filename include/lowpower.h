@@ -0,0 +1,43 @@
+// =============================
+// Low-Power Logging ('log')
+// =============================
+// For battery-powered field units logging slowly (1-20 Hz). Instead of the
+// sample timer, acquisition task and serial UI running flat out, the CPU is
+// clocked down to LOWPOWER_CPU_MHZ and put into light sleep between samples:
+// the RTC timer wakes it shortly before each sample is due, it takes one
+// oversampled reading and goes straight back to sleep. Samples collect in a
+// RAM batch (kept through light sleep), and only a full batch wakes the file
+// system: it is appended to the recording file as one chunk (storage.h) and
+// flushed, so at most one batch is lost if the battery dies.
+//
+// Logging blocks loop() until any character arrives on the serial port (the
+// UART wakes the chip); the character itself is discarded. esp_timer keeps
+// counting through light sleep, so sample times stay on the requested grid.
+//
+// Deep sleep with the ULP coprocessor filling RTC memory would save more, but
+// needs a ULP program and toolchain this project does not build; light sleep
+// keeps the normal ADC path and calibration while still idling at ~1 mA.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define LOWPOWER_MAX_RATE 20        // Highest 'log' rate (Hz); above this waking up costs more than it saves
+#define LOWPOWER_BATCH 512          // Samples per flash write
+#define LOWPOWER_CPU_MHZ 80         // CPU clock while logging (restored afterwards)
+#define LOWPOWER_WAKE_EARLY_US 1000 // Leave light sleep this long before a sample is due, then wait for it
+
+// Summary of the last 'log' session
+struct LowPowerStats {
+    uint32_t samples;       // Samples written
+    uint32_t batches;       // Chunks written (flash wake-ups)
+    uint32_t late;          // Samples taken more than one period late
+    uint64_t awakeMicros;   // Time spent awake
+    uint64_t totalMicros;   // Length of the session
+    bool writeFailed;       // The file system filled up; logging stopped there
+};
+
+// Log one channel at rateHz to `path` until a character arrives on Serial
+bool lowPowerLog(fs::FS &fs, const char *path, int rateHz);
+const LowPowerStats &lowPowerStats();
@@ -0,0 +1,45 @@
+// =============================
+// Network Transport (Wi-Fi)
+// =============================
+// Lets a recorder work without a USB cable to a PC. Built in only when the
+// environment sets WIFI_SSID (and WIFI_PASSWORD) as build flags, so every
+// unit of a fleet joins the same network on power-up:
+//
+//   - commands: a TCP server on NET_COMMAND_PORT takes the same command lines
+//     as the serial port (e.g. `nc <ip> 23`), one client at a time. While a
+//     client is connected it also receives all console output (console.h).
+//   - samples: 'net stream <collector-ip> [port]' sends the live samples over
+//     UDP. Each datagram is one frame (frame.h): FRAME_STREAM_DATA frames of
+//     up to NET_PACKET_SAMPLES samples, so a collector decodes them exactly
+//     like a serial stream and tells recorders apart by source address. The
+//     start frame is repeated every NET_START_REPEAT_MS so a collector that
+//     starts late still learns the rate. tools/decode_stream.py --udp is one.
+//
+// A network task on core 0 (with loop() and the Wi-Fi stack, away from the
+// acquisition task) drains liveRing into packets; loop() leaves liveRing to
+// it while a network stream runs. Command handling stays in loop().
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define NET_COMMAND_PORT 23         // TCP port for remote commands
+#define NET_STREAM_PORT 9750        // Default UDP port on the collector
+#define NET_PACKET_SAMPLES 500      // Samples per datagram (keeps each frame within FRAME_MAX_PAYLOAD)
+#define NET_FLUSH_MS 50             // Send a partial packet if samples have waited this long
+#define NET_START_REPEAT_MS 1000    // Resend the start frame this often
+#define NET_TASK_STACK 4096         // Network task stack size (bytes)
+#define NET_TASK_PRIORITY 2         // Above loopTask (1), below the file sink writer (3)
+#define NET_CORE 0                  // Runs next to loop() and the Wi-Fi stack
+
+void netBegin();                    // Start joining WIFI_SSID (no-op when built without it)
+bool netAvailable();                // Built with network support
+void netSuspend();                  // Drop the client and turn Wi-Fi off (netBegin() rejoins)
+char *netCommandPoll();             // Call from loop(): next command line from the remote client, or nullptr
+void printNetInfo();                // Connection, client and stream state
+bool netStreamBegin(const char *host, uint16_t port); // Start streaming liveRing to host:port (false if not connected or bad address)
+void netStreamEnd();                // Flush, send the end frame and stop the network task's stream
+bool netStreamActive();
+uint32_t netStreamSent();           // Samples sent in the current/last network stream
+uint32_t netStreamDropped();        // Samples lost (liveRing overflow or packets the stack refused)
+uint32_t netStreamPackets();        // Datagrams sent
@@ -0,0 +1,38 @@
+// =============================
+// Adaptive Oversampling ('samples auto')
+// =============================
+// Picks adcSamples from the requested rate instead of leaving the user to
+// balance 'rate' against 'samples'. The cost of one conversion (adc1_get_raw()
+// plus the settling delay) is measured at startup; each recording then starts
+// with the largest factor whose reading fits AUTO_HEADROOM_PERCENT of the
+// sample period for every channel.
+//
+// While recording in precise mode the acquisition task watches each sample:
+// one that finishes too close to the next tick (or a missed tick) is a slip,
+// and after AUTO_SLIP_LIMIT slips in a row adcSamples is cut to 3/4. It never
+// grows back during a recording, so the precision only drops when the
+// schedule really demands it. In fast mode oversampling is done by the DMA
+// stream, so auto simply uses the largest decimation the stream rate allows.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define AUTO_HEADROOM_PERCENT 70    // Share of the sample period a reading may use
+#define AUTO_SLIP_PERCENT 90        // A sample finishing later than this share of the period is a slip
+#define AUTO_SLIP_LIMIT 3           // Slips in a row before oversampling is reduced
+#define AUTO_MAX_SAMPLES 1024       // Upper bound, same as 'samples'
+#define AUTO_COST_READS 256         // Conversions timed by measureAdcReadCost()
+
+extern bool autoOversampling;       // 'samples auto' is on
+
+void measureAdcReadCost();          // Time one conversion (call once from setup(), with ADC1 idle)
+float adcReadMicros();              // Measured cost of one conversion (us)
+int autoSamplesFor(int rateHz);     // Largest oversampling that fits rateHz with the current channels and mode
+void autoOversampleBegin(uint32_t periodMicros); // Acquisition start: reset slip tracking
+// Acquisition task, precise mode: one sample started `lateMicros` after its tick
+// and took `frameReadMicros`; returns true if adcSamples was just reduced
+bool autoOversampleCheck(uint32_t lateMicros, uint32_t frameReadMicros, bool missedTick);
+uint32_t autoOversampleReductions(); // Reductions made during the current/last recording
+int autoOversampleStartSamples();   // adcSamples the current/last recording started with
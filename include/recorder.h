@@ -0,0 +1,161 @@
+// =============================
+// ESP32 High-Fidelity Voltage Recorder - Shared Definitions
+// =============================
+// Pin assignments, recording settings and the global state that is shared
+// between main.cpp and the other recorder modules in src/.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include <esp_adc_cal.h>     // ESP32 ADC calibration for accurate readings
+#include <FS.h>              // fs::FS (record-to-file targets)
+#include <driver/adc.h>      // adc1_channel_t
+#include "decimator.h"       // FilterType
+
+// =============================
+// Build Profile
+// =============================
+// Each PlatformIO env in platformio.ini is a build profile. A profile
+// overrides any of the settings marked "(profile)" below with -D build
+// flags; the rest keep their defaults. Everything here is compile-time, so a
+// profile costs nothing at run time.
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE "standard"    // Shown at startup and in 'status'
+#endif
+
+// =============================
+// Pin Definitions
+// =============================
+#ifndef ADC_PIN
+#define ADC_PIN 36          // (profile) GPIO36 (ADC1_CH0) - Connect your voltage source here (0-3.3V max!)
+#endif
+#define DAC_PIN 25          // GPIO25 (DAC1) - Outputs recorded voltages for replay
+#ifndef LED_PIN
+#define LED_PIN 2           // (profile) Built-in LED for status indication
+#endif
+#define DAC2_PIN 26         // GPIO26 (DAC2) - Second replay output for multi-channel recordings
+#define ADC1_INPUTS 8       // ADC1 channels brought out to pins (GPIO32-39)
+#ifndef MAX_CHANNELS
+#define MAX_CHANNELS 8      // (profile) ADC1 inputs that can be recorded together
+#endif
+static_assert(MAX_CHANNELS >= 1 && MAX_CHANNELS <= ADC1_INPUTS, "MAX_CHANNELS must be 1-8");
+// (profile) DEFAULT_CHANNEL_MASK: channelMask() selected at power-up instead of ADC_PIN alone
+#ifdef DEFAULT_CHANNEL_MASK
+static_assert(DEFAULT_CHANNEL_MASK > 0 && DEFAULT_CHANNEL_MASK <= 0xFF && __builtin_popcount(DEFAULT_CHANNEL_MASK) <= MAX_CHANNELS,
+              "DEFAULT_CHANNEL_MASK must select 1 to MAX_CHANNELS of the ADC1 inputs");
+#endif
+
+// ADC1 channel on an ADC1 GPIO, or -1
+constexpr int adc1ChannelOf(int gpio) {
+    return gpio >= 36 && gpio <= 39 ? gpio - 36 : gpio >= 32 && gpio <= 35 ? gpio - 28 : -1;
+}
+static_assert(adc1ChannelOf(ADC_PIN) >= 0, "ADC_PIN must be an ADC1 pin (GPIO32-39)");
+
+// =============================
+// Serial Link
+// =============================
+#define DEFAULT_BAUD_RATE 115200    // Baud rate at power-up (matches monitor_speed)
+#define BAUD_CONFIRM_MS 2000        // Time the host has to confirm a new baud rate
+
+// =============================
+// ADC (Analog to Digital Converter) Configuration
+// =============================
+#ifndef ADC_VREF
+#define ADC_VREF 1000       // (profile) Reference voltage in mV, used when the eFuse holds no calibration
+#endif
+#define ADC_MAX_CODE 4095   // Largest 12-bit ADC code
+#define RAW_FRAC_BITS 4     // Fractional bits kept on averaged/filtered raw codes
+
+// =============================
+// Sample Storage
+// =============================
+// Samples are stored as 16-bit fixed-point voltages in units of 0.1 mV
+// (the same resolution as the %.4f V output format). The acquisition path
+// stays in integer math; conversion to volts happens only when printing.
+typedef uint16_t sample_t;
+#define SAMPLE_UNITS_PER_VOLT 10000     // sample_t counts per volt (0.1 mV per count)
+#define SAMPLE_FULL_SCALE 33000         // 3.3 V expressed in sample_t counts
+
+// Convert a stored sample to volts
+inline float sampleToVolts(sample_t sample) {
+    return (float)sample / SAMPLE_UNITS_PER_VOLT;
+}
+
+// Convert a stored sample to an 8-bit DAC code (0-255 for 0-3.3V, clamped)
+inline uint8_t sampleToDacCode(sample_t sample) {
+    uint32_t clamped = sample > SAMPLE_FULL_SCALE ? SAMPLE_FULL_SCALE : sample;
+    return (uint8_t)(clamped * 255 / SAMPLE_FULL_SCALE);
+}
+
+// =============================
+// Recording Settings
+// =============================
+#ifndef BASELINE_SAMPLE_RATE
+#define BASELINE_SAMPLE_RATE 60 // (profile) Baseline sample rate in Hz
+#endif
+#ifndef BASELINE_ADC_SAMPLES
+#define BASELINE_ADC_SAMPLES 32  // (profile) Baseline ADC samples per reading
+#endif
+#ifndef DEFAULT_SAMPLE_RATE
+#define DEFAULT_SAMPLE_RATE BASELINE_SAMPLE_RATE // (profile) Sample rate at power-up in Hz (samples per second)
+#endif
+#ifndef DEFAULT_ACQ_MODE
+#define DEFAULT_ACQ_MODE ACQ_PRECISE // (profile) Acquisition mode at power-up
+#endif
+
+// Acquisition modes
+enum AcquisitionMode {
+    ACQ_PRECISE,    // Timer-driven adc1_get_raw() oversampling (default)
+    ACQ_FAST        // Continuous I2S DMA stream, decimated in blocks
+};
+
+// =============================
+// Global Variables (defined in main.cpp)
+// =============================
+extern volatile bool recording;                // True if currently recording
+extern sample_t *voltageBuffer;                // Buffer to store recorded voltages (0.1 mV units, see sample_arena.h)
+extern int maxSamples;                         // Capacity of voltageBuffer in samples (sized at startup)
+extern volatile int sampleCount;               // Number of samples recorded (written by the acquisition task)
+extern int channelCount;                       // Channels per frame in voltageBuffer (see channels.h)
+extern adc1_channel_t channelList[MAX_CHANNELS]; // ADC1 channel of each frame slot, ascending
+extern int sampleRate;                         // Current sample rate in Hz
+extern int recordedRate;                       // Rate voltageBuffer was captured at (Hz); 'rate' does not change it
+extern esp_adc_cal_characteristics_t adc_chars;// ADC calibration characteristics
+extern unsigned long recordingStartTime;       // Time when recording started (ms)
+extern unsigned long recordingEndTime;         // Time when recording ended (ms)
+extern float adcOffset;                        // ADC offset (in volts) measured during calibration
+extern uint32_t adcOffsetUnits;                // Same offset in sample_t units (used in the acquisition path)
+extern int adcSamples;                         // Oversampling: number of samples per reading
+extern AcquisitionMode acqMode;                // How samples are acquired while recording
+extern FilterType filterType;                  // Fast mode decimation filter
+extern uint32_t serialBaud;                    // Current serial baud rate
+
+// Frames (one sample per channel) held in voltageBuffer
+inline int frameCount() {
+    return sampleCount / channelCount;
+}
+
+// =============================
+// Function Declarations
+// =============================
+void setupADC();
+void setupDAC();
+float readVoltageHighPrecision();
+sample_t readSampleHighPrecision(int slot = 0);
+float currentVoltage();
+void processSerialCommands();
+void startRecording();
+void startTriggeredRecording();
+void startStreaming();
+void startNetStreaming(const char *host, uint16_t port);
+struct FileSinkConfig;
+void startFileRecording(fs::FS &fs, const char *path, const FileSinkConfig &config);
+void startLowPowerLog(fs::FS &fs, const char *path); // Blocks until a key is pressed
+void stopRecording();
+void replayVoltages(uint32_t passes);
+void reportReplayFinished();
+void printStatus();
+void printHelp();
+void printData();
+void calibrateADCOffset();
+bool negotiateBaudRate(uint32_t newBaud);
@@ -0,0 +1,61 @@
+// =============================
+// DMA Replay Engine
+// =============================
+// Replays voltageBuffer through the I2S0 built-in DAC mode. The DAC is clocked
+// by the I2S peripheral at a fixed output rate that is an exact multiple of
+// the recording's sample rate, and a feeder task keeps the DMA buffers full,
+// so output timing is set by hardware rather than by delayMicroseconds().
+//
+// Replay runs entirely in the background: loop() stays free for 'status',
+// 'read' and 'stop', and looping replays walk voltageBuffer in place. A
+// recording file (storage.h) can be replayed directly, one chunk at a time.
+//
+// A multi-channel recording (channels.h) plays one channel on DAC1 (GPIO25)
+// and, if mapped with 'dac', a second one on DAC2 (GPIO26) in the same
+// frames, so the two outputs stay sample-aligned.
+//
+// Between samples the DAC either holds each one or follows an interpolated
+// curve with optional dither ('interp', 'dither'); see interpolator.h.
+//
+// 'replay speed' resamples on the fly: the DAC clock stays the one chosen for
+// the recorded rate, and each DAC update advances through the recording by
+// speed / repeat of a sample interval, so nothing is copied or precomputed.
+// Above a speed of `repeat` some intervals get no update at all, i.e. samples
+// are skipped.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define REPLAY_MIN_DAC_RATE 20000   // Lowest I2S DAC clock used (Hz); each sample is repeated to reach it
+#define REPLAY_INTERP_DAC_RATE 48000 // Lowest DAC clock for 'interp linear' / 'interp fir' (Hz)
+#define REPLAY_DMA_BUF_LEN 512      // Frames per DMA buffer
+#define REPLAY_DMA_BUF_COUNT 8      // Number of DMA buffers
+#define REPLAY_TASK_STACK 4096      // Feeder task stack size (bytes)
+#define REPLAY_TASK_PRIORITY 18     // Feeder task priority (core ACQ_CORE)
+
+#define REPLAY_LOOP_FOREVER 0           // replayStart() pass count for 'replay loop'
+#define REPLAY_SPEED_ONE 1000           // replaySetSpeed() units: 1000 = as recorded
+#define REPLAY_SPEED_MIN 100            // 0.1x
+#define REPLAY_SPEED_MAX 10000          // 10x
+
+bool replayStart(uint32_t passes);  // Replay voltageBuffer[0..sampleCount) at recordedRate `passes` times (0 = until stopped) in the background
+bool replayStartFile(fs::FS &fs, const char *path, uint32_t passes); // Same, streaming a recording file
+void replayStop();                  // Stop early; returns once the DAC is back at 0 V
+void replaySetDacSlots(int dac1, int dac2); // Frame slots replayed on DAC1 and DAC2 (dac2 = -1: DAC2 off)
+int replayDacSlot(int dac);         // Slot set for DAC1 (0) or DAC2 (1); -1 = off
+int replayOutputSlot(int dac);      // Slot on DAC1 (0) or DAC2 (1) in the current/last replay (-1 = not used)
+void replaySetSpeed(uint32_t speed); // Playback speed for the next replay (REPLAY_SPEED_ONE = as recorded)
+uint32_t replaySpeed();
+bool replayActive();                // True until the last sample has left the DAC
+uint32_t replayPosition();          // Frames handed to the DMA so far (all passes)
+uint32_t replayLength();            // Frames per pass (0 while a file of unknown length is on its first pass)
+uint32_t replaySampleRate();        // Sample rate being replayed (Hz)
+uint32_t replayPass();              // Pass currently playing (0-based)
+uint32_t replayPasses();            // Requested passes (REPLAY_LOOP_FOREVER = until stopped)
+uint32_t replayOutputRate();        // I2S DAC update rate of the current/last replay (Hz)
+uint32_t replayRepeat();            // DAC updates per recorded sample
+int64_t replayDurationMicros();     // Wall-clock duration of the last completed replay
+uint32_t replayMaxJitterMicros();   // Worst deviation of the feeder's DMA refills from the buffer period (us)
+bool replayReadFailed();            // The last file replay ended because a pass read no frames
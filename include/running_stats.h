@@ -0,0 +1,53 @@
+// =============================
+// Running Statistics
+// =============================
+// Min/max/mean/variance kept up to date as samples are appended, so 'status'
+// never has to scan voltageBuffer. Samples are integers (0.1 mV units), so
+// the moments are kept as exact integer sums: the per-sample update is a few
+// integer adds with no float math, and mean/variance are derived on demand.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+struct RunningStats {
+    uint32_t count;     // Samples included
+    sample_t minSample; // Smallest sample
+    sample_t maxSample; // Largest sample
+    sample_t latest;    // Most recent sample (the cached "current voltage" while recording)
+    uint64_t sum;       // Sum of samples
+    uint64_t sumSq;     // Sum of squared samples
+
+    void reset() {
+        count = 0;
+        minSample = 0;
+        maxSample = 0;
+        latest = 0;
+        sum = 0;
+        sumSq = 0;
+    }
+
+    // O(1) per-sample update
+    inline void add(sample_t sample) {
+        if (count == 0 || sample < minSample) minSample = sample;
+        if (count == 0 || sample > maxSample) maxSample = sample;
+        latest = sample;
+        sum += sample;
+        sumSq += (uint32_t)sample * sample;
+        count++;
+    }
+
+    // Mean in volts
+    float meanVolts() const {
+        return count ? (float)((double)sum / count / SAMPLE_UNITS_PER_VOLT) : 0.0;
+    }
+
+    // Population standard deviation in volts
+    float stdDevVolts() const {
+        if (count == 0) return 0.0;
+        double mean = (double)sum / count;
+        double variance = (double)sumSq / count - mean * mean;
+        return variance > 0 ? (float)(sqrt(variance) / SAMPLE_UNITS_PER_VOLT) : 0.0;
+    }
+};
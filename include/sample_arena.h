@@ -0,0 +1,22 @@
+// =============================
+// Runtime-Sized Sample Arena
+// =============================
+// voltageBuffer is allocated at startup instead of being a fixed array. On
+// boards with PSRAM the arena lives there; otherwise it takes the largest free
+// DRAM block, leaving ARENA_RESERVE_BYTES for the rest of the firmware.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define ARENA_RESERVE_BYTES (64 * 1024)  // DRAM kept free for tasks, drivers and serial buffers
+#define ARENA_MIN_BYTES (4 * 1024)       // Smallest arena worth allocating
+
+#ifndef ARENA_MAX_KB
+#define ARENA_MAX_KB 0                   // Default arena cap in KB (0 = use all available memory)
+#endif
+
+bool allocateSampleArena(uint32_t capKB); // (Re)allocate voltageBuffer; capKB = 0 means no cap. Clears the buffer.
+size_t sampleArenaBytes();                // Bytes currently allocated for samples
+bool sampleArenaInPsram();                // True if the arena was placed in external PSRAM
+void printArenaInfo();                    // One-line description of the arena (size, location, capacity)
@@ -0,0 +1,55 @@
+// =============================
+// Timer-Driven Sampling Engine
+// =============================
+// An esp_timer schedules every sample with microsecond precision and wakes a
+// dedicated acquisition task, so sampling no longer depends on how often
+// loop() gets around to polling millis(). Each tick is armed for
+// start + n * 1 s / rate, so the average rate is exact even when the period is
+// not a whole number of microseconds.
+//
+// In fast mode (acqMode == ACQ_FAST) the timer is not used: the ADC streams
+// through I2S DMA (see adc_dma.h) and the acquisition task decimates blocks.
+//
+// The acquisition task is pinned to ACQ_CORE at high priority; the Arduino
+// loop() (serial commands and output) runs on the other core. Every stored
+// sample is also pushed into liveRing so the UI can follow along without
+// ever touching the acquisition path.
+//
+// With several channels (channels.h) each period stores a whole frame, and
+// liveRing and the running statistics follow the first channel.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+#include "spsc_ring.h"
+#include "running_stats.h"
+
+#define ACQ_CORE 1              // Core the acquisition task is pinned to (loop() runs on core 0)
+#define LIVE_RING_SIZE 1024     // Samples buffered between the acquisition task and the UI
+
+// One sample as seen by the UI side
+struct LiveSample {
+    uint32_t index;     // Frame number since samplerStart() (frame position in voltageBuffer when storing)
+    uint32_t micros;    // Time since samplerStart() in microseconds
+    sample_t sample;    // Recorded voltage of the first channel (0.1 mV units)
+};
+
+extern SpscRing<LiveSample, LIVE_RING_SIZE> liveRing; // Acquisition task -> UI
+
+void setupSampler();              // Create the acquisition task and the sample timer (call once from setup())
+bool samplerStart(int rateHz);    // Start acquisition at rateHz in the current acqMode; samples go into voltageBuffer
+void samplerStop();               // Disarm the timer; returns once the sample in progress (if any) is stored
+bool samplerBufferFull();         // True once the acquisition task has filled voltageBuffer
+uint32_t samplerMissedTicks();    // Timer ticks that fired while the previous sample was still being taken
+uint32_t samplerPeriodMicros();   // Current sample period in whole microseconds (0 when stopped)
+uint32_t samplerStreamRate();     // Fast mode: ADC stream rate in Hz, all channels together (0 when stopped or in precise mode)
+uint32_t samplerDecimation();     // Fast mode: stream samples of one channel averaged into each output sample
+void samplerSetStoring(bool enable); // false: samples only go to liveRing (streaming); call before samplerStart()
+void samplerSetTriggered(bool enable); // true: triggered capture (see trigger.h); call before samplerStart()
+bool samplerTriggered();          // Triggered capture: the trigger has fired
+uint32_t samplerTriggerIndex();   // Triggered capture: acquisition index of the trigger sample
+int samplerFinishCapture();       // After samplerStop(): unroll the circular buffer; returns samples kept
+void samplerGetStats(RunningStats &out); // Consistent snapshot of the running statistics (safe from any core)
+void samplerResetStats();                // Clear the running statistics (not while recording)
+void samplerRebuildStats();              // Recompute from voltageBuffer after it was filled some other way
@@ -0,0 +1,36 @@
+// =============================
+// SD Card Recording Backend
+// =============================
+// A microSD card on the VSPI bus gives the file sink (file_sink.h) room for
+// multi-hour captures at kHz rates. Blocks are triple-buffered, the header
+// is padded to a full sector and every block is a whole 4 KB chunk, so each
+// write is 8 aligned sectors that FATFS can pass straight to the card. The
+// file is flushed every SD_SYNC_BLOCKS blocks by default ('sd sync <N>'):
+// flushing rewrites FAT and directory sectors, so flushing every block
+// costs throughput, while a reset loses at most the blocks since the last
+// flush.
+//
+// SPI is used rather than SDMMC because the SDMMC data lines include GPIO2,
+// the status LED.
+//
+// Wiring (VSPI): CS GPIO5, SCK GPIO18, MISO GPIO19, MOSI GPIO23
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "file_sink.h"
+
+#ifndef SD_CS_PIN
+#define SD_CS_PIN 5                 // Card chip select
+#endif
+#define SD_SPI_FREQ 20000000        // SPI clock once the card is up (Hz)
+#define SD_BUFFERS 3                // Triple-buffered blocks
+#define SD_SYNC_BLOCKS 16           // Default flush interval (16 blocks = 64 KB)
+
+bool sdBegin();                     // Mount the card (safe to call again after a card swap)
+bool sdMounted();
+fs::FS &sdFileSystem();
+FileSinkConfig sdSinkConfig();      // Buffering and flush policy for recording to the card
+void sdSetSyncBlocks(uint16_t blocks); // 0 = flush only when the recording ends
+void printSdInfo();                 // Card type, size and free space
@@ -0,0 +1,67 @@
+// =============================
+// Spectrum Analysis
+// =============================
+// 'spectrum' runs an FFT over a window of voltageBuffer and reports its
+// frequency content without pulling the recording off the board:
+//
+//   - the strongest tones that stand out of the noise, with frequencies
+//     refined between bins by parabolic interpolation and levels summed over
+//     each window lobe
+//   - THD of the strongest tone (harmonics 2..SPECTRUM_HARMONICS below
+//     Nyquist, relative to the fundamental)
+//   - the noise floor: average power per bin of everything that is not DC,
+//     the fundamental or a harmonic, and the SNR it gives
+//
+// The FFT is a real-input, in-place radix-2 transform in single-precision
+// float (the ESP32 has an FPU): N samples are packed into N/2 complex points,
+// transformed, and split into the N/2 + 1 one-sided bins. It works in one
+// static scratch buffer of SPECTRUM_MAX_POINTS floats, so no call touches the
+// heap the sample arena is carved from. The recording's mean is removed
+// before windowing and reported separately, so DC never masks a tone.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define SPECTRUM_MAX_POINTS 4096    // Largest FFT (16 KB scratch, static)
+#define SPECTRUM_MIN_POINTS 64      // Smallest FFT worth reporting
+#define SPECTRUM_PEAKS 5            // Strongest tones reported
+#define SPECTRUM_HARMONICS 9        // Highest harmonic included in THD
+#define SPECTRUM_PEAK_MIN_DB 10     // Weaker tones are only reported if this far above the noise floor
+
+enum WindowType : uint8_t {
+    WINDOW_RECT,        // No window: narrowest lobe, worst leakage (exact-bin tones only)
+    WINDOW_HANN,        // Default: good general-purpose trade-off
+    WINDOW_BLACKMAN,    // 4-term Blackman-Harris: -92 dB sidelobes, for THD and noise floor
+    WINDOW_FLATTOP      // Flat top: accurate tone levels, wide lobe
+};
+
+extern WindowType spectrumWindow;   // Used by the next 'spectrum'
+
+const char *windowName(WindowType type);
+
+struct SpectrumPeak {
+    float frequency;    // Hz, interpolated between bins
+    float rms;          // Volts RMS, summed over the window lobe
+};
+
+struct SpectrumResult {
+    uint32_t points;        // FFT length (samples)
+    uint32_t firstFrame;    // First frame analysed
+    float binHz;            // Bin spacing
+    float dc;               // Mean of the window (volts)
+    uint8_t peakCount;      // Valid entries in peaks[], strongest first
+    SpectrumPeak peaks[SPECTRUM_PEAKS];
+    uint8_t harmonics;      // Harmonics found below Nyquist (THD uses these)
+    float thdPercent;       // Harmonic RMS / fundamental RMS
+    float noiseFloorDb;     // Average noise power per bin (dBV)
+    float noiseRms;         // Noise over the whole band (volts RMS)
+    float snrDb;            // Fundamental / noise
+};
+
+// Analyse `points` frames of one channel (slot in channelList) from firstFrame.
+// points must be a power of two between SPECTRUM_MIN_POINTS and
+// SPECTRUM_MAX_POINTS and the frames must be in voltageBuffer.
+bool spectrumAnalyze(uint32_t firstFrame, uint32_t points, int slot, WindowType window, SpectrumResult &result);
+void printSpectrum(const SpectrumResult &result); // Human-readable report
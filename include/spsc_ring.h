@@ -0,0 +1,60 @@
+// =============================
+// Lock-Free Single-Producer / Single-Consumer Ring Buffer
+// =============================
+// Used to hand samples from the acquisition task (producer, core 1) to the
+// serial/UI side (consumer, core 0) without locks. push() never blocks: if the
+// consumer falls behind, the item is dropped and counted, so a slow consumer
+// can never stall acquisition.
+// =============================
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    // Producer side: append one item. Returns false (and counts a drop) when full.
+    bool push(const T &item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= N) {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release); // Publish after the item is written
+        return true;
+    }
+
+    // Consumer side: take the oldest item. Returns false when empty.
+    bool pop(T &item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        item = items_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release); // Free the slot after the item is read
+        return true;
+    }
+
+    // Consumer side: discard everything currently queued.
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    void resetDropped() { dropped_.store(0, std::memory_order_relaxed); }
+
+private:
+    T items_[N];
+    std::atomic<uint32_t> head_{0};    // Next slot to write (producer)
+    std::atomic<uint32_t> tail_{0};    // Next slot to read (consumer)
+    std::atomic<uint32_t> dropped_{0}; // Items rejected because the ring was full
+};
@@ -0,0 +1,84 @@
+// =============================
+// Recording Files (LittleFS)
+// =============================
+// Recordings are saved to the on-board flash so they survive a reset or a
+// brown-out. A file is a fixed header followed by self-checking chunks:
+//
+//   header (RECORDING_HEADER_BYTES, at offset 0):
+//     "VREC" | version u8 | units_per_volt u16 | sample_rate u32 | adc_samples u16
+//     | adc_offset u16 | mode u8 | count u32 | dropped u32 | chunk_samples u16
+//     | data_offset u16 | flags u8 | channels u8 | channel_mask u8 | reserved
+//   chunk (repeated from data_offset):
+//     first_index u32 | count u16 | samples u16[count] | crc16 u16
+//
+// All fields are little-endian, samples are in 0.1 mV units and the CRC is
+// CRC-16/CCITT-FALSE (see frame.h) over the chunk's index, count and samples.
+// Multi-channel recordings (channels.h) store interleaved frames; count is
+// in samples and channel_mask has bit n set for each recorded ADC1 channel n.
+// A full chunk is exactly one 4 KB flash block. With RECORDING_FLAG_PADDED
+// every chunk occupies a full block (short ones are padded), so that, with a
+// sector-aligned data_offset, each block write lands on sector boundaries;
+// the SD card sink writes files this way. Chunks are complete by
+// themselves, so a file cut short by a reset is still readable up to its last
+// whole chunk; the header count is only rewritten when a recording ends.
+// Readers walk the chunks instead of seeking, which lets replay stream a file
+// of any length through a single chunk buffer.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "recorder.h"
+
+#define RECORDING_MAGIC "VREC"
+#define RECORDING_VERSION 1
+#define RECORDING_HEADER_BYTES 32
+#define RECORDING_EXT ".vrec"
+#define RECORDING_NAME_MAX 24           // Longest recording name (characters)
+#define CHUNK_HEADER_BYTES 6            // first_index u32 + count u16
+#define CHUNK_SAMPLES 2044              // Samples in a full chunk (one 4 KB flash block with header and CRC)
+#define CHUNK_BYTES(n) (CHUNK_HEADER_BYTES + 2 * (n) + 2)
+#define RECORDING_FLAG_PADDED 0x01      // Every chunk is padded to CHUNK_BYTES(chunk_samples)
+
+// Contents of a recording file header
+struct RecordingHeader {
+    uint32_t sampleRate;    // Hz
+    uint16_t adcSamples;    // Oversampling used while recording
+    uint16_t offsetUnits;   // ADC offset at the time (already applied to the samples)
+    uint8_t mode;           // AcquisitionMode
+    uint32_t count;         // Samples in the file (0 if the recording never finished)
+    uint32_t dropped;       // Samples lost while recording to the file
+    uint16_t chunkSamples;  // Samples in a full chunk
+    uint16_t dataOffset;    // Offset of the first chunk
+    uint8_t flags;          // RECORDING_FLAG_*
+    uint8_t channels;       // Samples per frame (files from before multi-channel recording read as 1)
+    uint8_t channelMask;    // Recorded ADC1 channels (channelMask())
+};
+
+// Chunk-by-chunk reader over one recording file
+class RecordingReader {
+public:
+    bool open(fs::FS &fs, const char *path); // Open and check the header
+    void rewind();                           // Back to the first chunk
+    size_t readChunk(sample_t *out);         // Next chunk's samples (up to CHUNK_SAMPLES); 0 at the end or on a bad chunk
+    void close();
+    const RecordingHeader &header() const { return info; }
+    uint32_t lastIndex() const { return firstIndex; } // first_index of the chunk just read
+    bool corrupt() const { return badChunk; }        // Reading stopped at a chunk that failed its CRC
+private:
+    fs::File file;
+    RecordingHeader info;
+    uint32_t firstIndex = 0;
+    bool badChunk = false;
+    uint8_t chunk[CHUNK_BYTES(CHUNK_SAMPLES)];
+};
+
+bool storageBegin();                        // Mount LittleFS (formats it on first use)
+bool recordingPath(const char *name, char *path, size_t size); // Validate a name and build its file path
+RecordingHeader currentRecordingHeader();   // Header describing voltageBuffer and the current settings
+void encodeRecordingHeader(uint8_t *out, const RecordingHeader &header); // RECORDING_HEADER_BYTES bytes
+size_t encodeChunk(uint8_t *out, uint32_t firstIndex, const sample_t *samples, size_t count); // Returns bytes used
+bool saveRecording(const char *name);       // Write voltageBuffer to /<name>.vrec
+bool loadRecording(const char *name);       // Read /<name>.vrec into voltageBuffer (sets recordedRate)
+bool removeRecording(const char *name);
+int listRecordings(fs::FS &fs);             // Print every recording with its length and rate; returns how many
@@ -0,0 +1,20 @@
+// =============================
+// Streaming Record-to-Serial Mode
+// =============================
+// While streaming, samples are not kept in voltageBuffer. loop() drains
+// liveRing into FRAME_STREAM_DATA frames (see frame.h), so a capture can run
+// for as long as the host keeps reading.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+
+#define STREAM_FRAME_SAMPLES 128  // Samples per data frame
+#define STREAM_FLUSH_MS 20        // Send a partial frame if samples have waited this long
+
+void streamBegin();       // Send the start frame and begin draining liveRing
+void streamService();     // Call from loop(): turn queued samples into frames
+void streamEnd();         // Flush, send the end frame and leave streaming mode
+bool streamActive();      // True between streamBegin() and streamEnd()
+uint32_t streamSent();    // Samples sent in the current/last stream
+uint32_t streamDropped(); // Samples lost because the serial link could not keep up
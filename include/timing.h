@@ -0,0 +1,58 @@
+// =============================
+// Sample Timing Instrumentation
+// =============================
+// Measures how well the acquisition task keeps to its schedule, instead of
+// inferring it from the total duration:
+//
+//   - every sample's interval from the previous one, as a histogram of the
+//     deviation from the nominal period (jitter)
+//   - the latest sample relative to its scheduled time (start + n * period)
+//   - deadline misses: samples that were not finished by the next tick
+//   - time spent taking the reading (readSampleHighPrecision() for every
+//     channel)
+//
+// In fast mode the hardware clocks the ADC, so the same figures are kept per
+// DMA block instead: block arrival jitter and the time spent filtering and
+// storing each block.
+//
+// While storing, the acquisition task also records the esp_timer time of
+// the first frame of every block of frames (the block size grows with the
+// arena so the table stays at TIMING_MAX_STAMPS entries). 'show' interpolates between these stamps, so printed
+// sample times are measured rather than i / rate.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define TIMING_BINS 12          // Jitter histogram bins (see timingBinLimit())
+#define TIMING_MAX_STAMPS 1024  // Timestamps kept per recording (4 KB)
+
+struct TimingStats {
+    bool blocks;                    // Fast mode: figures are per DMA block
+    uint32_t nominalMicros;         // Expected interval (sample period or DMA block period)
+    uint32_t count;                 // Intervals measured
+    uint32_t histogram[TIMING_BINS];// |interval - nominal| per bin
+    uint32_t minInterval;           // Shortest interval (us)
+    uint32_t maxInterval;           // Longest interval (us)
+    int32_t worstLate;              // Latest start relative to schedule (us)
+    uint32_t worstLateIndex;        // Sample (or block) it happened at
+    uint32_t deadlineMisses;        // Not finished by the next scheduled tick
+    uint32_t workMin;               // Time taking the reading / processing the block (us)
+    uint32_t workMax;
+    uint64_t workTotal;
+    uint32_t workCount;
+};
+
+uint32_t timingBinLimit(int bin);           // Upper bound of a histogram bin in us (last bin: unbounded)
+void timingReset(uint32_t nominalMicros, bool blocks); // Start measuring (samplerStart())
+// Acquisition task: one sample/block started at `micros`, scheduled for
+// `scheduledMicros`, whose reading or processing took `workMicros`
+void timingRecord(uint32_t index, uint32_t micros, uint32_t scheduledMicros, uint32_t workMicros);
+void timingGet(TimingStats &out);           // Consistent snapshot (safe from any core)
+void printTiming();                         // The 'timing' report
+
+void timingBeginStamps(uint32_t frameCapacity); // Start a new timestamp table for up to frameCapacity frames
+void timingStamp(uint32_t frame, uint32_t micros); // Acquisition task: frame stored at `micros`
+void timingClearStamps();                   // voltageBuffer no longer matches the stamps (load, clear, ...)
+float sampleTimeMs(uint32_t frame);         // Measured time of a stored frame (ms), or frame / recordedRate without stamps
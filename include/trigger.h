@@ -0,0 +1,57 @@
+// =============================
+// Triggered Capture
+// =============================
+// In triggered mode ('arm') the acquisition task samples continuously into
+// voltageBuffer used as a circular buffer of pre + post samples. Nothing is
+// kept until the trigger condition is met; then `post` more samples
+// (including the trigger sample) are taken and the capture stops, leaving
+// the `pre` samples that led up to the event in front of it, like a scope's
+// single-shot mode. The trigger is only evaluated once `pre` samples have
+// been collected, so the pre-trigger window is always complete.
+//
+//   above/below  - level: fires on the first sample above/below the level
+//   rising/falling - edge: fires when the input crosses the level
+//   window       - fires when the input leaves the [low, high] window
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+
+#define TRIGGER_DEFAULT_PRE 1000  // Pre-trigger samples kept by default
+
+enum TriggerType {
+    TRIG_OFF,
+    TRIG_ABOVE,
+    TRIG_BELOW,
+    TRIG_RISING,
+    TRIG_FALLING,
+    TRIG_WINDOW
+};
+
+struct TriggerConfig {
+    TriggerType type;
+    sample_t level;     // Trigger level (window: lower bound)
+    sample_t high;      // Window: upper bound
+    uint32_t pre;       // Samples kept before the trigger sample
+    uint32_t post;      // Samples kept from the trigger sample on (0 = rest of the arena)
+};
+
+extern TriggerConfig triggerConfig; // Set with the 'trigger' command
+
+const char *triggerName(TriggerType type);
+void printTriggerConfig();
+uint32_t triggerPostSamples();      // Resolved post-trigger length for the current arena
+
+// True if `sample` (preceded by `prev`) meets the trigger condition
+inline bool triggerFires(const TriggerConfig &config, sample_t prev, sample_t sample) {
+    switch (config.type) {
+        case TRIG_ABOVE:   return sample > config.level;
+        case TRIG_BELOW:   return sample < config.level;
+        case TRIG_RISING:  return prev < config.level && sample >= config.level;
+        case TRIG_FALLING: return prev > config.level && sample <= config.level;
+        case TRIG_WINDOW:  return prev >= config.level && prev <= config.high &&
+                                  (sample < config.level || sample > config.high);
+        default:           return false;
+    }
+}
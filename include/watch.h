@@ -0,0 +1,72 @@
+// =============================
+// Inline Event Detection ('watch')
+// =============================
+// Watches samples as they leave liveRing, in whichever consumer is draining
+// it (loop() while recording to RAM, a file or the serial stream; the network
+// task while streaming over UDP), and reports events the moment they happen:
+//
+//   rise / fall  - the input crosses the watch level (Schmitt trigger: rise
+//                  above level + hysteresis, fall below level - hysteresis)
+//   spike        - the input jumps more than `spike` away from its recent
+//                  average (an exponential moving average of about
+//                  2^WATCH_BASELINE_SHIFT samples); re-arms once it is back
+//                  within spike - hysteresis
+//   dropout      - the input stays below the dropout level for the minimum
+//                  duration; `restore` follows once it is back above
+//                  level + hysteresis
+//   gap          - samples the detectors never saw (liveRing overflowed)
+//
+// Each sample costs a few integer compares whatever is enabled. Events go
+// through a small queue to loop(), which prints each one as a compact
+// `EVENT,<type>,<index>,<time_s>,<value>` line, or, while streaming, sends it
+// as a FRAME_EVENT frame so the binary stream stays parseable.
+// =============================
+#pragma once
+
+#include <Arduino.h>
+#include "recorder.h"
+#include "sampler.h"
+
+#define WATCH_QUEUE_SIZE 64             // Events between the detectors and loop()
+#define WATCH_BASELINE_SHIFT 4          // Spike baseline: moving average over ~16 samples
+#define WATCH_DEFAULT_HYSTERESIS 100    // 10 mV
+#define WATCH_DEFAULT_DROPOUT_MS 10     // Shortest dropout reported
+
+enum WatchEventType : uint8_t {
+    WATCH_RISE,
+    WATCH_FALL,
+    WATCH_SPIKE,
+    WATCH_DROPOUT,
+    WATCH_RESTORE,
+    WATCH_GAP,
+    WATCH_EVENT_TYPES
+};
+
+struct WatchConfig {
+    bool levelOn;           // Report rise/fall crossings of `level`
+    sample_t level;
+    sample_t spike;         // Spike size (0 = off)
+    bool dropoutOn;         // Report dropouts below `dropout`
+    sample_t dropout;
+    uint16_t dropoutMs;     // Minimum dropout duration
+    sample_t hysteresis;    // Shared by all detectors
+};
+
+// One event, as queued for loop() and sent in FRAME_EVENT
+struct WatchEvent {
+    uint32_t index;     // Frame the event happened at (dropout: its first low frame; gap: first frame missed)
+    uint32_t micros;    // Time of that frame since the capture started (gap: of the next frame seen)
+    sample_t value;     // Sample that caused the event (gap: samples missed, capped at 65535)
+    uint8_t type;       // WatchEventType
+};
+
+extern WatchConfig watchConfig; // Set with the 'watch' command
+
+const char *watchEventName(uint8_t type);
+bool watchEnabled();                    // Any detector configured
+void watchBegin(int rateHz);            // Reset the detectors for a new capture
+void watchSample(const LiveSample &live); // O(1): run the detectors on one sample (liveRing consumer only)
+void watchService();                    // Call from loop(): print or send queued events
+uint32_t watchEventCount(uint8_t type); // Events of one type since watchBegin()
+uint32_t watchLostEvents();             // Events dropped because the queue was full
+void printWatchConfig();
@@ -0,0 +1,70 @@
+// =============================
+// Continuous ADC (I2S DMA) Acquisition
+// =============================
+
+#include "adc_dma.h"
+#include "recorder.h"
+#include <driver/i2s.h>      // I2S driver (built-in ADC mode)
+#include <driver/adc.h>      // ESP32 ADC driver for analog input
+#include <soc/syscon_struct.h> // SAR ADC pattern table
+
+static QueueHandle_t i2sEvents = nullptr;  // I2S driver event queue (used to detect overflows)
+static uint32_t overflowCount = 0;         // DMA buffers lost since adcDmaStart()
+static bool streaming = false;             // True while I2S0 is installed in ADC mode
+
+bool adcDmaStart(uint32_t streamRate) {
+    if (streaming) adcDmaStop();
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    config.sample_rate = streamRate;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = 0;
+    config.dma_buf_count = ADC_DMA_BUF_COUNT;
+    config.dma_buf_len = ADC_DMA_BUF_LEN;
+    config.use_apll = false;
+    if (i2s_driver_install(I2S_NUM_0, &config, 4, &i2sEvents) != ESP_OK) {
+        return false;
+    }
+    i2s_set_adc_mode(ADC_UNIT_1, channelList[0]);
+    i2s_adc_enable(I2S_NUM_0);
+    if (channelCount > 1) {
+        // i2s_adc_enable() reloads a one-entry table, so extend it afterwards.
+        // Each entry is channel << 4 | width << 2 | atten (12 bit, 11 dB),
+        // four entries per register, first entry in the top byte.
+        uint32_t table[4] = {};
+        for (int i = 0; i < channelCount; i++) {
+            table[i / 4] |= (uint32_t)((channelList[i] << 4) | 0x0F) << (24 - 8 * (i % 4));
+        }
+        for (int i = 0; i < 4; i++) SYSCON.saradc_sar1_patt_tab[i] = table[i];
+        SYSCON.saradc_ctrl.sar1_patt_len = channelCount - 1;
+    }
+    overflowCount = 0;
+    streaming = true;
+    return true;
+}
+
+size_t adcDmaRead(uint16_t *raw, size_t maxSamples, uint32_t timeoutMs) {
+    if (!streaming) return 0;
+    // Count DMA buffers the driver had to discard since the last read
+    i2s_event_t event;
+    while (xQueueReceive(i2sEvents, &event, 0) == pdTRUE) {
+        if (event.type == I2S_EVENT_RX_Q_OVF) overflowCount++;
+    }
+    size_t bytesRead = 0;
+    i2s_read(I2S_NUM_0, raw, maxSamples * sizeof(uint16_t), &bytesRead, pdMS_TO_TICKS(timeoutMs));
+    return bytesRead / sizeof(uint16_t); // Channel bits are left for adcDmaChannel()
+}
+
+uint32_t adcDmaOverflows() {
+    return overflowCount;
+}
+
+void adcDmaStop() {
+    if (!streaming) return;
+    i2s_adc_disable(I2S_NUM_0);
+    i2s_driver_uninstall(I2S_NUM_0);
+    i2sEvents = nullptr;
+    streaming = false;
+}
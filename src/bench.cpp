@@ -0,0 +1,193 @@
+// =============================
+// On-Device Benchmarks
+// =============================
+
+#include "bench.h"
+#include "console.h"
+#include "recorder.h"
+#include "sampler.h"
+#include "timing.h"
+#include "replay.h"
+#include "compress.h"
+#include "frame.h"
+#include "dump.h"
+#include <driver/dac.h>      // ESP32 DAC driver for analog output
+
+static void benchValue(const char *metric, double value, const char *unit) {
+    console.printf("BENCH,%s,%.3f,%s\n", metric, value, unit);
+}
+
+static void benchSkipped(const char *metric, const char *reason) {
+    console.printf("BENCH,%s,skipped,%s\n", metric, reason);
+}
+
+// Cost of readSampleHighPrecision() for every power-of-two oversampling factor
+static float benchReadCost() {
+    int savedSamples = adcSamples;
+    float currentCost = 0;
+    char metric[24];
+    for (int n = 1; n <= 1024; n *= 2) {
+        adcSamples = n;
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < BENCH_READS; i++) readSampleHighPrecision();
+        float cost = (float)(esp_timer_get_time() - start) / BENCH_READS;
+        snprintf(metric, sizeof(metric), "read_us_s%d", n);
+        benchValue(metric, cost, "us");
+        if (n == savedSamples) currentCost = cost;
+    }
+    adcSamples = savedSamples;
+    if (currentCost == 0) {
+        // Not a power of two: time the current setting on its own
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < BENCH_READS; i++) readSampleHighPrecision();
+        currentCost = (float)(esp_timer_get_time() - start) / BENCH_READS;
+    }
+    return currentCost * channelCount;
+}
+
+// Run the sampler (not storing) at `rate` and report whether it kept up
+static bool benchRateTrial(int rate) {
+    liveRing.clear();
+    samplerSetStoring(false);
+    recording = true; // The acquisition task only samples while recording
+    samplerStart(rate);
+    delay(BENCH_RATE_RUN_MS);
+    samplerStop();
+    recording = false;
+    samplerSetStoring(true);
+    liveRing.clear();
+    TimingStats timing;
+    timingGet(timing);
+    return samplerMissedTicks() == 0 && timing.deadlineMisses == 0;
+}
+
+// Highest precise-mode rate that runs without a missed deadline, starting
+// from the reading cost and backing off 10% per failed trial. The trials
+// reset the statistics and timestamps, so a recording in RAM is left alone.
+static void benchMaxRate(float frameCost) {
+    if (sampleCount > 0) {
+        benchSkipped("max_rate", "buffer_not_empty");
+        return;
+    }
+    AcquisitionMode savedMode = acqMode;
+    int savedSamples = adcSamples; // 'samples auto' re-picks it for every trial rate
+    acqMode = ACQ_PRECISE;
+    int rate = min(10000, (int)(1000000.0 / frameCost));
+    bool sustained = false;
+    for (int trial = 0; trial < BENCH_RATE_TRIALS && rate > 0; trial++) {
+        if (benchRateTrial(rate)) {
+            sustained = true;
+            break;
+        }
+        rate = rate * 9 / 10;
+    }
+    acqMode = savedMode;
+    adcSamples = savedSamples;
+    if (sustained) {
+        benchValue("max_rate", rate, "Hz");
+    } else {
+        benchSkipped("max_rate", "no_rate_sustained");
+    }
+    timingClearStamps();
+    samplerResetStats(); // Nothing is recorded, so 'status' should not show the trials
+}
+
+// Replay a synthetic ramp and report how steadily the feeder refilled the DMA
+static void benchReplay() {
+    if (sampleCount > 0) {
+        benchSkipped("replay_jitter", "buffer_not_empty");
+        return;
+    }
+    if (maxSamples < BENCH_REPLAY_SAMPLES * channelCount) {
+        benchSkipped("replay_jitter", "arena_too_small");
+        return;
+    }
+    int savedRate = recordedRate;
+    uint32_t savedSpeed = replaySpeed();
+    storageCompressed = false;
+    for (int i = 0; i < BENCH_REPLAY_SAMPLES * channelCount; i++) {
+        voltageBuffer[i] = (sample_t)((uint32_t)i * SAMPLE_FULL_SCALE / (BENCH_REPLAY_SAMPLES * channelCount));
+    }
+    sampleCount = BENCH_REPLAY_SAMPLES * channelCount;
+    recordedRate = BENCH_REPLAY_RATE;
+    replaySetSpeed(REPLAY_SPEED_ONE);
+    if (replayStart(1)) {
+        while (replayActive()) delay(5);
+        float expected = (float)BENCH_REPLAY_SAMPLES * 1000000 / BENCH_REPLAY_RATE;
+        benchValue("replay_jitter", replayMaxJitterMicros(), "us");
+        benchValue("replay_duration_error", (replayDurationMicros() - expected) / 1000.0, "ms");
+    } else {
+        benchSkipped("replay_jitter", "replay_failed");
+    }
+    sampleCount = 0;
+    recordedRate = savedRate;
+    replaySetSpeed(savedSpeed);
+}
+
+// Build dump data frames (read, pack, CRC) without sending them. The serial
+// link's limit follows from the baud rate and is printed alongside for
+// reference, since the slower of the two sets the export speed.
+static void benchExport() {
+    static uint8_t payload[6 + 2 * DUMP_FRAME_SAMPLES];
+    int count = sampleCount > 0 ? sampleCount : min(maxSamples, 32768);
+    bool synthetic = sampleCount == 0;
+    if (synthetic) storageCompressed = false; // Read whatever the arena holds
+    int64_t start = esp_timer_get_time();
+    SampleReader reader;
+    reader.begin();
+    uint16_t crc = 0xFFFF;
+    for (int first = 0; first < count; first += DUMP_FRAME_SAMPLES) {
+        int n = min(DUMP_FRAME_SAMPLES, count - first);
+        uint8_t *p = putU32(payload, first);
+        p = putU16(p, n);
+        for (int i = 0; i < n; i++) {
+            p = putU16(p, synthetic ? voltageBuffer[first + i] : reader.next());
+        }
+        crc = crc16Update(crc, payload + 6, 2 * n);
+    }
+    float seconds = (esp_timer_get_time() - start) / 1000000.0;
+    benchValue("export_encode", count * sizeof(sample_t) / 1024.0 / seconds, "KB/s");
+    benchValue("export_link", serialBaud / 10 / 1024.0, "KB/s"); // 8N1: 10 bits per byte
+}
+
+// Sweep DAC1 and read the input back; GPIO25 must be wired to the first channel
+static void benchLoopback() {
+    dac_output_enable(DAC_CHANNEL_1);
+    dac_output_voltage(DAC_CHANNEL_1, 255);
+    delay(5);
+    if (readVoltageHighPrecision() < BENCH_LOOPBACK_MIN_V) {
+        dac_output_voltage(DAC_CHANNEL_1, 0);
+        benchSkipped("loopback_max_error", "not_wired");
+        return;
+    }
+    float maxError = 0;
+    float totalError = 0;
+    int points = 0;
+    for (int code = 0; code <= 255; code += BENCH_LOOPBACK_STEP) {
+        dac_output_voltage(DAC_CHANNEL_1, code);
+        delay(2); // Let the DAC output and the input settle
+        float error = fabs(readVoltageHighPrecision() - code * 3.3 / 255);
+        if (error > maxError) maxError = error;
+        totalError += error;
+        points++;
+    }
+    dac_output_voltage(DAC_CHANNEL_1, 0);
+    benchValue("loopback_max_error", maxError * 1000, "mV");
+    benchValue("loopback_mean_error", totalError / points * 1000, "mV");
+}
+
+void runBenchmarks() {
+    if (recording || replayActive()) {
+        console.println("Stop recording/replay before running benchmarks.");
+        return;
+    }
+    console.printf("BENCH,begin,%s\n", VERSION);
+    benchValue("samples", adcSamples, "count");
+    benchValue("channels", channelCount, "count");
+    float frameCost = benchReadCost();
+    benchMaxRate(frameCost);
+    benchReplay();
+    benchExport();
+    benchLoopback();
+    console.println("BENCH,end");
+}
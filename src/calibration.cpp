@@ -0,0 +1,148 @@
+// =============================
+// Lookup-Table Calibration
+// =============================
+
+#include "calibration.h"
+#include "console.h"
+#include <driver/adc.h>      // ESP32 ADC driver for analog input
+
+sample_t calLut[ADC_MAX_CODE + 2];
+int16_t channelOffsetUnits[MAX_CHANNELS];
+
+// One user calibration point
+struct CalPoint {
+    uint32_t raw;       // Averaged raw code (<< RAW_FRAC_BITS) measured at the point
+    int32_t units;      // Known input voltage (sample_t units)
+    int32_t correction; // units minus the eFuse-characterised value at raw
+};
+
+static CalPoint points[MAX_CAL_POINTS]; // User points, sorted by raw
+static int pointCount = 0;
+static bool groundSet = false;          // calibrateADCOffset() has measured the ground point
+static uint32_t groundRaw = 0;          // Raw code (<< RAW_FRAC_BITS) read with the input grounded
+
+// Points used to build the table: the user points plus the ground point
+static CalPoint merged[MAX_CAL_POINTS + 1];
+static int mergedCount = 0;
+
+// eFuse-characterised value for one raw code, before any correction
+static int32_t baseUnits(uint32_t code) {
+    return esp_adc_cal_raw_to_voltage(code, &adc_chars) * (SAMPLE_UNITS_PER_VOLT / 1000);
+}
+
+// Uncorrected value at a fractional raw code
+static int32_t baseUnitsFrac(uint32_t raw) {
+    uint32_t code = min(raw >> RAW_FRAC_BITS, (uint32_t)ADC_MAX_CODE);
+    uint32_t frac = (code == ADC_MAX_CODE) ? 0 : raw & ((1 << RAW_FRAC_BITS) - 1);
+    int32_t low = baseUnits(code);
+    int32_t high = frac ? baseUnits(code + 1) : low;
+    return low + (((high - low) * (int32_t)frac) >> RAW_FRAC_BITS);
+}
+
+// Piecewise-linear correction at a raw code (<< RAW_FRAC_BITS)
+static int32_t correctionAt(uint32_t raw) {
+    if (mergedCount == 0) return 0;
+    if (raw <= merged[0].raw) return merged[0].correction;
+    for (int i = 1; i < mergedCount; i++) {
+        if (raw <= merged[i].raw) {
+            const CalPoint &a = merged[i - 1];
+            const CalPoint &b = merged[i];
+            return a.correction + (int32_t)((int64_t)(b.correction - a.correction) * (int32_t)(raw - a.raw) / (int32_t)(b.raw - a.raw));
+        }
+    }
+    return merged[mergedCount - 1].correction;
+}
+
+// The ground offset is just another calibration point (0 V at groundRaw).
+// With no user points this reproduces the plain offset subtraction.
+static void mergePoints() {
+    mergedCount = 0;
+    bool groundPending = groundSet;
+    for (int i = 0; i < pointCount; i++) {
+        if (groundPending && groundRaw <= points[i].raw) {
+            if (groundRaw < points[i].raw) merged[mergedCount++] = { groundRaw, 0, -baseUnitsFrac(groundRaw) };
+            groundPending = false;
+        }
+        merged[mergedCount++] = points[i];
+    }
+    if (groundPending) merged[mergedCount++] = { groundRaw, 0, -baseUnitsFrac(groundRaw) };
+}
+
+void setGroundCalibration(uint32_t raw) {
+    groundRaw = raw;
+    groundSet = true;
+    adcOffsetUnits = baseUnitsFrac(raw);
+    adcOffset = (float)adcOffsetUnits / SAMPLE_UNITS_PER_VOLT;
+    buildCalibrationLut();
+}
+
+void setChannelOffset(int slot, uint32_t raw) {
+    // Difference between this slot's ground and slot 0's, taken before the
+    // table so an input that reads below slot 0 keeps its (negative) offset
+    int32_t units = slot == 0 ? 0 : baseUnitsFrac(raw) - (int32_t)adcOffsetUnits;
+    channelOffsetUnits[slot] = (int16_t)constrain(units, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+}
+
+void clearChannelOffsets() {
+    memset(channelOffsetUnits, 0, sizeof(channelOffsetUnits));
+}
+
+void buildCalibrationLut() {
+    mergePoints();
+    for (uint32_t code = 0; code <= ADC_MAX_CODE; code++) {
+        int32_t units = baseUnits(code) + correctionAt(code << RAW_FRAC_BITS);
+        if (units < 0) units = 0;                // Clamp to zero
+        if (units > 0xFFFF) units = 0xFFFF;
+        calLut[code] = units;
+    }
+    calLut[ADC_MAX_CODE + 1] = calLut[ADC_MAX_CODE];
+}
+
+bool addCalibrationPoint(float volts) {
+    if (pointCount >= MAX_CAL_POINTS) {
+        console.printf("Calibration table full (%d points). Use 'calpoint clear' first.\n", MAX_CAL_POINTS);
+        return false;
+    }
+    uint32_t total = 0;
+    for (int i = 0; i < CAL_POINT_SAMPLES; i++) {
+        total += adc1_get_raw(channelList[0]);
+        delayMicroseconds(10);
+    }
+    uint32_t raw = (total << RAW_FRAC_BITS) / CAL_POINT_SAMPLES;
+    CalPoint point;
+    point.raw = raw;
+    point.units = (int32_t)(volts * SAMPLE_UNITS_PER_VOLT + 0.5);
+    point.correction = point.units - baseUnitsFrac(raw);
+    // Insert sorted by raw code, replacing a point at the same code
+    int i = 0;
+    while (i < pointCount && points[i].raw < raw) i++;
+    if (i < pointCount && points[i].raw == raw) {
+        points[i] = point;
+    } else {
+        memmove(&points[i + 1], &points[i], (pointCount - i) * sizeof(CalPoint));
+        points[i] = point;
+        pointCount++;
+    }
+    buildCalibrationLut();
+    console.printf("Calibration point: raw %.2f = %.4f V (correction %+.4f V)\n",
+                  (float)raw / (1 << RAW_FRAC_BITS), volts, (float)point.correction / SAMPLE_UNITS_PER_VOLT);
+    return true;
+}
+
+void clearCalibrationPoints() {
+    pointCount = 0;
+    buildCalibrationLut();
+}
+
+void printCalibrationPoints() {
+    if (pointCount == 0) {
+        console.printf("No user calibration points (eFuse calibration + %.4f V offset only).\n", adcOffset);
+        return;
+    }
+    console.printf("Ground offset: %.4f V\n", adcOffset);
+    console.println("Raw code,Voltage(V),Correction(V)");
+    for (int i = 0; i < pointCount; i++) {
+        console.printf("%.2f,%.4f,%+.4f\n", (float)points[i].raw / (1 << RAW_FRAC_BITS),
+                      (float)points[i].units / SAMPLE_UNITS_PER_VOLT, (float)points[i].correction / SAMPLE_UNITS_PER_VOLT);
+    }
+}
@@ -0,0 +1,57 @@
+// =============================
+// Multi-Channel Input Selection
+// =============================
+
+#include "channels.h"
+#include "console.h"
+#include "calibration.h"
+
+// GPIO of ADC1 channel 0..7
+static const uint8_t channelPins[ADC1_INPUTS] = { 36, 37, 38, 39, 32, 33, 34, 35 };
+
+int channelGpio(adc1_channel_t channel) {
+    return channelPins[channel];
+}
+
+bool gpioChannel(int gpio, adc1_channel_t &channel) {
+    for (int i = 0; i < ADC1_INPUTS; i++) {
+        if (channelPins[i] == gpio) {
+            channel = (adc1_channel_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool setChannels(const adc1_channel_t *channels, int count) {
+    uint8_t mask = 0;
+    for (int i = 0; i < count; i++) {
+        if (mask & (1 << channels[i])) return false; // Duplicate
+        mask |= 1 << channels[i];
+    }
+    return setChannelMask(mask);
+}
+
+uint8_t channelMask() {
+    uint8_t mask = 0;
+    for (int i = 0; i < channelCount; i++) mask |= 1 << channelList[i];
+    return mask;
+}
+
+bool setChannelMask(uint8_t mask) {
+    if (mask == 0 || __builtin_popcount(mask) > MAX_CHANNELS) return false;
+    channelCount = 0;
+    for (int i = 0; i < ADC1_INPUTS; i++) {
+        if (!(mask & (1 << i))) continue;
+        channelList[channelCount++] = (adc1_channel_t)i;
+        adc1_config_channel_atten((adc1_channel_t)i, ADC_ATTEN_11db); // Full 0-3.3V range on every input
+    }
+    clearChannelOffsets(); // Offsets were measured for the old slots
+    return true;
+}
+
+void printChannels() {
+    for (int i = 0; i < channelCount; i++) {
+        console.printf("%sGPIO%d", i > 0 ? ", " : "", channelGpio(channelList[i]));
+    }
+}
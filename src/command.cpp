@@ -0,0 +1,78 @@
+// =============================
+// Serial Command Parser
+// =============================
+
+#include "command.h"
+#include "console.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+static CommandLine serialLine;
+
+char *commandRead(CommandLine &line, Stream &input) {
+    while (input.available()) {
+        char c = input.read();
+        if (c == '\n' || c == '\r') {
+            if (line.overflowed) {
+                line.overflowed = false;
+                line.length = 0;
+                console.printf("Command too long (max %d characters).\n", CMD_LINE_MAX);
+                continue;
+            }
+            if (line.length == 0) continue; // Blank line, or the \n of a \r\n pair
+            line.buffer[line.length] = '\0';
+            line.length = 0;
+            return line.buffer; // Valid until the next call
+        }
+        if (line.length < CMD_LINE_MAX) {
+            line.buffer[line.length++] = tolower((unsigned char)c);
+        } else {
+            line.overflowed = true;
+        }
+    }
+    return nullptr;
+}
+
+char *commandPoll() {
+    return commandRead(serialLine, Serial);
+}
+
+int commandTokenize(char *line, char **argv, int maxArgs) {
+    int argc = 0;
+    char *p = line;
+    while (*p && argc < maxArgs) {
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        argv[argc++] = p;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        if (*p) *p++ = '\0';
+    }
+    return argc;
+}
+
+bool commandDispatch(const Command *table, size_t count, char *line) {
+    char *argv[CMD_MAX_ARGS];
+    int argc = commandTokenize(line, argv, CMD_MAX_ARGS);
+    if (argc == 0) return true;
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(argv[0], table[i].name) == 0 || (table[i].alias && strcmp(argv[0], table[i].alias) == 0)) {
+            table[i].handler(argc, argv);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseInteger(const char *text, long &value) {
+    if (!text) return false;
+    char *end;
+    value = strtol(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+bool parseNumber(const char *text, float &value) {
+    if (!text) return false;
+    char *end;
+    value = strtof(text, &end);
+    return end != text && *end == '\0';
+}
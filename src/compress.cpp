@@ -0,0 +1,66 @@
+// =============================
+// Compressed Recording
+// =============================
+
+#include "compress.h"
+#include "sample_arena.h"
+
+bool compressionEnabled = false;
+bool storageCompressed = false;
+
+static uint8_t *out = nullptr;      // Arena as bytes
+static uint32_t used = 0;           // Bytes written
+static uint32_t capacity = 0;       // Arena size in bytes
+static sample_t previous = 0;       // Last sample appended
+static uint32_t pendingRun = 0;     // Repeats of `previous` not yet written
+
+// Write one LEB128 varint token
+static void putToken(uint32_t token) {
+    while (token >= 0x80) {
+        out[used++] = (uint8_t)(token | 0x80);
+        token >>= 7;
+    }
+    out[used++] = (uint8_t)token;
+}
+
+void compressBegin() {
+    out = (uint8_t *)voltageBuffer;
+    capacity = sampleArenaBytes();
+    used = 0;
+    previous = 0;
+    pendingRun = 0;
+    storageCompressed = true;
+}
+
+bool compressAppend(sample_t sample) {
+    if (used + COMPRESS_RESERVE > capacity) return false;
+    if (sample == previous && sampleCount > 0) {
+        if (++pendingRun == COMPRESS_MAX_RUN) compressFlush();
+        return true;
+    }
+    compressFlush();
+    int32_t delta = (int32_t)sample - previous;
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    putToken(zigzag << 1);
+    previous = sample;
+    return true;
+}
+
+bool compressHasRoom(int samples) {
+    return used + samples * COMPRESS_RESERVE <= capacity;
+}
+
+void compressFlush() {
+    if (pendingRun == 0) return;
+    putToken((pendingRun << 1) | 1);
+    pendingRun = 0;
+}
+
+uint32_t compressedBytes() {
+    return storageCompressed ? used : sampleCount * sizeof(sample_t);
+}
+
+float compressionRatio() {
+    if (!storageCompressed || used == 0) return 1.0;
+    return (float)(sampleCount * sizeof(sample_t)) / used;
+}
@@ -0,0 +1,138 @@
+// =============================
+// Decimation Filters (Fast Mode)
+// =============================
+
+#include "decimator.h"
+#include "recorder.h"
+#include "const_math.h"
+#include <array>
+
+// -----------------------------
+// Compile-time half-band coefficients
+// -----------------------------
+// Blackman-windowed sinc with cutoff at a quarter of the input rate, in Q15.
+// Every other tap of a half-band filter is zero, so only the odd taps and the
+// centre tap are kept. The centre tap is trimmed so the DC gain is exactly 1.
+
+static constexpr int32_t roundQ15(double v) {
+    return (int32_t)(v * 32768.0 + (v >= 0 ? 0.5 : -0.5));
+}
+
+#define HALFBAND_CENTER ((HALFBAND_TAPS - 1) / 2)
+#define HALFBAND_ODD_TAPS ((HALFBAND_CENTER + 1) / 2)  // Non-zero taps on one side of the centre
+
+struct HalfbandCoefficients {
+    int32_t center;                              // Centre tap (Q15)
+    std::array<int32_t, HALFBAND_ODD_TAPS> odd;  // Taps at distance 1, 3, 5, ... from the centre (Q15)
+};
+
+static constexpr HalfbandCoefficients makeHalfband() {
+    HalfbandCoefficients h{};
+    const int m = HALFBAND_TAPS - 1;
+    int32_t oddSum = 0;
+    for (int j = 0; j < HALFBAND_ODD_TAPS; j++) {
+        int k = 2 * j + 1;              // Distance from the centre
+        int n = HALFBAND_CENTER + k;    // Tap index
+        double sinc = constSin(kPi * k / 2) / (kPi * k);
+        double window = 0.42 - 0.5 * constCos(2 * kPi * n / m) + 0.08 * constCos(4 * kPi * n / m);
+        h.odd[j] = roundQ15(sinc * window);
+        oddSum += h.odd[j];
+    }
+    h.center = 32768 - 2 * oddSum;      // Unity DC gain
+    return h;
+}
+
+static constexpr HalfbandCoefficients halfband = makeHalfband();
+static_assert(halfband.center > 16000 && halfband.center < 17000, "half-band centre tap should be ~0.5");
+
+// -----------------------------
+// Filter state
+// -----------------------------
+// Shared settings, plus one independent filter per channel slot
+static FilterType activeType = FILTER_BOX;
+static uint32_t cicRatio = 1;           // Decimation done by the box/CIC stage
+static uint64_t cicGain = 1;            // cicRatio ^ CIC_ORDER
+
+struct DecimatorState {
+    uint32_t phase;                     // Stream samples since the last box/CIC output
+    uint64_t boxSum;                    // Boxcar accumulator
+    uint64_t integrators[CIC_ORDER];    // CIC integrators (wrap-around arithmetic is intended)
+    uint64_t combDelay[CIC_ORDER];      // CIC comb delay elements
+    int32_t fifo[HALFBAND_TAPS];        // Half-band input history (raw << RAW_FRAC_BITS)
+    uint32_t fifoCount;                 // Inputs pushed into the half-band stage
+};
+
+static DecimatorState states[MAX_CHANNELS];
+
+const char *filterName(FilterType type) {
+    switch (type) {
+        case FILTER_CIC: return "cic";
+        case FILTER_FIR: return "fir";
+        default: return "box";
+    }
+}
+
+void decimatorBegin(FilterType type, uint32_t decimation) {
+    activeType = type;
+    cicRatio = (type == FILTER_FIR) ? max(1u, decimation / 2) : max(1u, decimation);
+    cicGain = 1;
+    for (int i = 0; i < CIC_ORDER; i++) cicGain *= cicRatio;
+    memset(states, 0, sizeof(states));
+}
+
+// CIC comb section, run once per cicRatio inputs; returns raw << RAW_FRAC_BITS
+static inline uint32_t cicComb(DecimatorState &st) {
+    uint64_t value = st.integrators[CIC_ORDER - 1];
+    for (int i = 0; i < CIC_ORDER; i++) {
+        uint64_t delayed = st.combDelay[i];
+        st.combDelay[i] = value;
+        value -= delayed;
+    }
+    return (uint32_t)(((value << RAW_FRAC_BITS) + cicGain / 2) / cicGain);
+}
+
+// Half-band stage: push one input, return true (and an output) every second input
+static inline bool halfbandPush(DecimatorState &st, uint32_t input, uint32_t &output) {
+    int32_t *fifo = st.fifo;
+    memmove(fifo, fifo + 1, (HALFBAND_TAPS - 1) * sizeof(int32_t));
+    fifo[HALFBAND_TAPS - 1] = (int32_t)input;
+    if ((++st.fifoCount & 1) != 0) return false;
+    int64_t acc = (int64_t)halfband.center * fifo[HALFBAND_CENTER];
+    for (int j = 0; j < HALFBAND_ODD_TAPS; j++) {
+        int k = 2 * j + 1;
+        acc += (int64_t)halfband.odd[j] * (fifo[HALFBAND_CENTER - k] + fifo[HALFBAND_CENTER + k]);
+    }
+    acc = (acc + 16384) >> 15;
+    output = acc < 0 ? 0 : (uint32_t)acc;
+    return true;
+}
+
+size_t decimatorProcess(int slot, const uint16_t *raw, size_t count, uint32_t *out, size_t maxOut) {
+    DecimatorState &st = states[slot];
+    size_t produced = 0;
+    for (size_t i = 0; i < count && produced < maxOut; i++) {
+        uint32_t stage;
+        if (activeType == FILTER_BOX) {
+            st.boxSum += raw[i];
+            if (++st.phase < cicRatio) continue;
+            stage = (uint32_t)(((st.boxSum << RAW_FRAC_BITS) + cicRatio / 2) / cicRatio);
+            st.boxSum = 0;
+        } else {
+            uint64_t value = raw[i];
+            for (int s = 0; s < CIC_ORDER; s++) {
+                st.integrators[s] += value;
+                value = st.integrators[s];
+            }
+            if (++st.phase < cicRatio) continue;
+            stage = cicComb(st);
+        }
+        st.phase = 0;
+        if (activeType == FILTER_FIR) {
+            uint32_t filtered;
+            if (halfbandPush(st, stage, filtered)) out[produced++] = filtered;
+        } else {
+            out[produced++] = stage;
+        }
+    }
+    return produced;
+}
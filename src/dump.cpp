@@ -0,0 +1,56 @@
+// =============================
+// Bulk Binary Export
+// =============================
+
+#include "dump.h"
+#include "frame.h"
+#include "recorder.h"
+#include "compress.h"
+#include "channels.h"
+
+void dumpBuffer() {
+    dumpFrames(0, frameCount());
+}
+
+void dumpFrames(uint32_t firstFrame, uint32_t frames) {
+    int count = frames * channelCount;
+    uint8_t header[24];
+    uint8_t *p = header;
+    p = putU8(p, FRAME_FORMAT_VERSION);
+    p = putU16(p, SAMPLE_UNITS_PER_VOLT);
+    p = putU32(p, recordedRate);
+    p = putU32(p, count);
+    p = putU16(p, adcOffsetUnits);
+    p = putU16(p, adcSamples);
+    p = putU8(p, acqMode);
+    p = putU8(p, channelCount);
+    p = putU8(p, channelMask());
+    p = putU32(p, firstFrame);
+    sendFrame(FRAME_DUMP_HEADER, header, p - header);
+
+    static uint8_t payload[6 + 2 * DUMP_FRAME_SAMPLES];
+    uint16_t dataCrc = 0xFFFF;
+    SampleReader reader; // Compressed recordings are expanded on the fly
+    reader.begin();
+    if (storageCompressed) {
+        while (reader.index < firstFrame * channelCount) reader.next();
+    } else {
+        reader.index = firstFrame * channelCount;
+    }
+    for (int first = 0; first < count; first += DUMP_FRAME_SAMPLES) {
+        int n = min(DUMP_FRAME_SAMPLES, count - first);
+        p = putU32(payload, first);
+        p = putU16(p, n);
+        for (int i = 0; i < n; i++) {
+            p = putU16(p, reader.next());
+        }
+        dataCrc = crc16Update(dataCrc, payload + 6, 2 * n);
+        sendFrame(FRAME_DUMP_DATA, payload, p - payload);
+    }
+
+    uint8_t end[6];
+    p = putU32(end, count);
+    putU16(p, dataCrc);
+    sendFrame(FRAME_DUMP_END, end, sizeof(end));
+    Serial.flush(); // Make sure the whole blob is on the wire before any text follows
+}
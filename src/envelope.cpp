@@ -0,0 +1,216 @@
+// =============================
+// Min/Max Envelope Pyramid
+// =============================
+
+#include "envelope.h"
+#include "frame.h"
+#include "compress.h"
+#include "channels.h"
+#include <atomic>
+
+#define ENVELOPE_MAX_LEVELS 12  // log2(ENVELOPE_ENTRIES / 2) + 1
+// Points per data frame: first_frame u32 plus a min/max pair per channel each
+#define OVERVIEW_POINTS_PER_FRAME(channels) ((FRAME_MAX_PAYLOAD - 4) / (4 + 4 * (channels)))
+
+static EnvelopeEntry pyramid[ENVELOPE_ENTRIES];
+static uint32_t levelStart[ENVELOPE_MAX_LEVELS]; // First node of each level
+static int levels = 0;
+static int envChannels = 1;
+static uint32_t leaves = 0;                     // Level-0 nodes per channel
+static volatile uint32_t blockFrames = 1;
+static uint32_t blocksDone = 0;                 // Complete level-0 blocks
+static uint32_t inBlock = 0;                    // Frames in the block being filled
+static EnvelopeEntry current[MAX_CHANNELS];     // Its min/max so far
+static volatile uint32_t framesAdded = 0;
+static std::atomic<uint32_t> layoutSeq{0};      // Odd while the pyramid is being regrown
+
+static inline EnvelopeEntry &node(int level, uint32_t index, int slot) {
+    return pyramid[(levelStart[level] + index) * envChannels + slot];
+}
+
+static inline void merge(EnvelopeEntry &into, const EnvelopeEntry &other) {
+    if (other.min < into.min) into.min = other.min;
+    if (other.max > into.max) into.max = other.max;
+}
+
+static void resetCurrent() {
+    for (int c = 0; c < envChannels; c++) current[c] = { 0xFFFF, 0 };
+    inBlock = 0;
+}
+
+// Complete the parents of level-0 node `index` that it finishes
+static void propagate(uint32_t index) {
+    for (int level = 0; (index & 1) && level + 1 < levels; level++, index >>= 1) {
+        for (int c = 0; c < envChannels; c++) {
+            EnvelopeEntry parent = node(level, index - 1, c);
+            merge(parent, node(level, index, c));
+            node(level + 1, index >> 1, c) = parent;
+        }
+    }
+}
+
+// Every block is in use: double the block size. Level 1 becomes level 0 and
+// the levels above it are rebuilt from there.
+static void regrow() {
+    layoutSeq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    uint32_t half = leaves / 2;
+    for (uint32_t i = 0; i < half; i++) {
+        for (int c = 0; c < envChannels; c++) node(0, i, c) = node(1, i, c);
+    }
+    for (uint32_t i = 0; i < half; i++) propagate(i);
+    blocksDone = half;
+    blockFrames = blockFrames * 2;
+    std::atomic_thread_fence(std::memory_order_release);
+    layoutSeq.fetch_add(1, std::memory_order_relaxed);
+}
+
+void envelopeBegin(uint32_t frameCapacity, int channels) {
+    envChannels = constrain(channels, 1, MAX_CHANNELS);
+    leaves = 1;
+    while (envChannels * (4 * leaves - 1) <= ENVELOPE_ENTRIES) leaves *= 2; // Full pyramid of twice the leaves still fits
+    uint32_t block = 1;
+    while ((uint64_t)block * leaves < frameCapacity) block *= 2;
+    blockFrames = block;
+    levels = 0;
+    uint32_t offset = 0;
+    for (uint32_t size = leaves; size > 0 && levels < ENVELOPE_MAX_LEVELS; size /= 2) {
+        levelStart[levels++] = offset;
+        offset += size;
+    }
+    blocksDone = 0;
+    framesAdded = 0;
+    resetCurrent();
+}
+
+void envelopeAdd(const sample_t *frame) {
+    for (int c = 0; c < envChannels; c++) {
+        if (frame[c] < current[c].min) current[c].min = frame[c];
+        if (frame[c] > current[c].max) current[c].max = frame[c];
+    }
+    if (++inBlock == blockFrames) {
+        for (int c = 0; c < envChannels; c++) node(0, blocksDone, c) = current[c];
+        propagate(blocksDone);
+        blocksDone++;
+        resetCurrent();
+        if (blocksDone == leaves) regrow(); // A compressed recording outgrew its estimate
+    }
+    std::atomic_thread_fence(std::memory_order_release); // Entries before the count
+    framesAdded = framesAdded + 1;
+}
+
+void envelopeRebuild() {
+    int frames = frameCount();
+    envelopeBegin(max((uint32_t)frames, (uint32_t)maxSamples / channelCount), channelCount);
+    SampleReader reader;
+    reader.begin();
+    sample_t frame[MAX_CHANNELS];
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < channelCount; c++) frame[c] = reader.next();
+        envelopeAdd(frame);
+    }
+}
+
+uint32_t envelopeFrames() {
+    return framesAdded;
+}
+
+uint32_t envelopeBlockFrames() {
+    return blockFrames;
+}
+
+EnvelopeEntry envelopeRange(uint32_t first, uint32_t frames, int slot) {
+    EnvelopeEntry result = { 0xFFFF, 0 };
+    uint32_t block = blockFrames;
+    uint32_t a = first / block;
+    uint32_t b = (first + frames) / block;
+    // Largest aligned node that fits at each step: at most two per level
+    while (a < b) {
+        int level = 0;
+        while (level + 1 < levels && (a & ((2u << level) - 1)) == 0 && a + (2u << level) <= b) level++;
+        merge(result, node(level, a >> level, slot));
+        a += 1u << level;
+    }
+    // The block still being filled (only complete once the capture has stopped)
+    if (!recording && (first + frames) % block != 0 && first + frames == framesAdded) merge(result, current[slot]);
+    return result;
+}
+
+// Min/max of every channel over frames [first, end), straight from the samples
+static void scanRange(SampleReader &reader, uint32_t first, uint32_t end, EnvelopeEntry *out) {
+    for (int c = 0; c < channelCount; c++) out[c] = { 0xFFFF, 0 };
+    while (reader.index < first * channelCount) reader.next();
+    for (uint32_t i = first; i < end; i++) {
+        for (int c = 0; c < channelCount; c++) {
+            sample_t sample = reader.next();
+            if (sample < out[c].min) out[c].min = sample;
+            if (sample > out[c].max) out[c].max = sample;
+        }
+    }
+}
+
+bool sendOverview(uint32_t points) {
+    uint32_t frames = framesAdded;
+    if (recording) frames = frames / blockFrames * blockFrames; // Whole blocks only while they are still coming
+    if (frames == 0 || points == 0) return false;
+    points = min(points, frames);
+    // Points narrower than a block are scanned, which is not safe while a compressed recording is being written
+    bool scan = frames / points < blockFrames;
+    if (scan && recording && storageCompressed) {
+        points = max(1U, frames / blockFrames);
+        scan = false;
+    }
+
+    uint8_t header[20];
+    uint8_t *p = header;
+    p = putU8(p, FRAME_FORMAT_VERSION);
+    p = putU16(p, SAMPLE_UNITS_PER_VOLT);
+    p = putU32(p, recordedRate);
+    p = putU32(p, frames);
+    p = putU16(p, points);
+    p = putU8(p, channelCount);
+    p = putU8(p, channelMask());
+    p = putU32(p, scan ? 0 : blockFrames);
+    sendFrame(FRAME_OVERVIEW_HEADER, header, p - header);
+
+    static uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint32_t perFrame = OVERVIEW_POINTS_PER_FRAME(channelCount);
+    SampleReader reader;
+    reader.begin();
+    EnvelopeEntry range[MAX_CHANNELS];
+    for (uint32_t firstPoint = 0; firstPoint < points; firstPoint += perFrame) {
+        uint32_t n = min(perFrame, points - firstPoint);
+        p = putU16(payload, firstPoint);
+        p = putU16(p, n);
+        for (uint32_t i = firstPoint; i < firstPoint + n; i++) {
+            uint32_t start = (uint64_t)frames * i / points;
+            uint32_t end = (uint64_t)frames * (i + 1) / points;
+            if (scan) {
+                scanRange(reader, start, end, range);
+            } else {
+                // Snap to whole blocks; retry if the pyramid regrew meanwhile
+                uint32_t seq;
+                do {
+                    seq = layoutSeq.load(std::memory_order_acquire);
+                    uint32_t block = blockFrames;
+                    start = start / block * block;
+                    if (i + 1 < points) end = end / block * block;
+                    for (int c = 0; c < channelCount; c++) range[c] = envelopeRange(start, end - start, c);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                } while ((seq & 1) || seq != layoutSeq.load(std::memory_order_relaxed));
+            }
+            p = putU32(p, start);
+            for (int c = 0; c < channelCount; c++) {
+                p = putU16(p, range[c].min);
+                p = putU16(p, range[c].max);
+            }
+        }
+        sendFrame(FRAME_OVERVIEW_DATA, payload, p - payload);
+    }
+
+    uint8_t end[2];
+    putU16(end, points);
+    sendFrame(FRAME_OVERVIEW_END, end, sizeof(end));
+    Serial.flush(); // Make sure the whole envelope is on the wire before any text follows
+    return true;
+}
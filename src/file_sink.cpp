@@ -0,0 +1,213 @@
+// =============================
+// Record-to-File Sink
+// =============================
+
+#include "file_sink.h"
+#include "storage.h"
+#include "sampler.h"
+#include "watch.h"
+
+// One chunk buffer: contiguous samples starting at firstIndex
+struct SinkBuffer {
+    uint32_t firstIndex;
+    uint16_t count;
+    sample_t samples[CHUNK_SAMPLES];
+};
+
+static SinkBuffer buffers[FILE_SINK_MAX_BUFFERS];
+static QueueHandle_t freeQueue = nullptr;    // Buffers loop() may fill
+static QueueHandle_t fullQueue = nullptr;    // Buffers waiting for the writer task
+static TaskHandle_t writerHandle = nullptr;
+static fs::File file;
+static FileSinkConfig config;
+static bool active = false;
+static volatile bool writeFailed = false;    // A write came up short (file system full)
+static int filling = -1;                     // Buffer loop() is filling (-1 = none)
+static uint32_t expectedIndex = 0;           // Index of the next sample we expect from liveRing
+static uint32_t writtenCount = 0;
+static uint32_t droppedCount = 0;
+static uint32_t droppedBlocks = 0;
+static volatile uint32_t committedCount = 0; // Samples the writer task has written successfully
+static volatile uint32_t blockCount = 0;     // Blocks the writer task has written
+static volatile uint32_t syncCount = 0;
+static volatile uint32_t maxWriteMicros = 0;
+static RecordingHeader header;
+
+// Writer task: encode and write each full buffer, then hand it back
+static void writerTask(void *arg) {
+    static uint8_t chunk[CHUNK_BYTES(CHUNK_SAMPLES)];
+    for (;;) {
+        uint8_t index;
+        xQueueReceive(fullQueue, &index, portMAX_DELAY);
+        SinkBuffer &buffer = buffers[index];
+        if (!writeFailed) {
+            int64_t start = esp_timer_get_time();
+            size_t bytes = encodeChunk(chunk, buffer.firstIndex, buffer.samples, buffer.count);
+            if (config.aligned) {
+                // Always a whole block, so every write starts on a sector boundary
+                memset(chunk + bytes, 0, sizeof(chunk) - bytes);
+                bytes = sizeof(chunk);
+            }
+            if (file.write(chunk, bytes) != bytes) {
+                writeFailed = true;
+            } else {
+                committedCount = committedCount + buffer.count;
+                blockCount = blockCount + 1;
+                if (config.syncBlocks > 0 && blockCount % config.syncBlocks == 0) {
+                    file.flush(); // Commit, so a reset loses at most the blocks since the last flush
+                    syncCount = syncCount + 1;
+                }
+            }
+            uint32_t elapsed = esp_timer_get_time() - start;
+            if (elapsed > maxWriteMicros) maxWriteMicros = elapsed;
+        }
+        xQueueSend(freeQueue, &index, portMAX_DELAY);
+    }
+}
+
+// Hand the buffer being filled to the writer (used for the last, partial block)
+static void submitBuffer() {
+    if (filling < 0) return;
+    uint8_t index = filling;
+    if (buffers[index].count > 0) {
+        xQueueSend(fullQueue, &index, portMAX_DELAY);
+    } else {
+        xQueueSend(freeQueue, &index, portMAX_DELAY);
+    }
+    filling = -1;
+}
+
+// Queue the current buffer and start filling a free one. If the writer still
+// has all the others, discard the current buffer's samples and refill it.
+static void nextBuffer() {
+    uint8_t index;
+    if (filling < 0) {
+        if (xQueueReceive(freeQueue, &index, 0) != pdTRUE) return;
+        filling = index;
+    } else if (buffers[filling].count > 0) {
+        if (xQueueReceive(freeQueue, &index, 0) != pdTRUE) {
+            droppedBlocks++;
+            droppedCount += buffers[filling].count;
+            writtenCount -= buffers[filling].count;
+            buffers[filling].count = 0;
+            return;
+        }
+        uint8_t full = filling;
+        xQueueSend(fullQueue, &full, portMAX_DELAY);
+        filling = index;
+    }
+    buffers[filling].count = 0;
+}
+
+bool fileSinkBegin(fs::FS &fs, const char *path, const FileSinkConfig &sinkConfig) {
+    if (active) return false;
+    if (writerHandle == nullptr) {
+        freeQueue = xQueueCreate(FILE_SINK_MAX_BUFFERS, sizeof(uint8_t));
+        fullQueue = xQueueCreate(FILE_SINK_MAX_BUFFERS, sizeof(uint8_t));
+        xTaskCreatePinnedToCore(writerTask, "filesink", FILE_SINK_TASK_STACK, nullptr, FILE_SINK_TASK_PRIORITY, &writerHandle, FILE_SINK_CORE);
+    }
+    config = sinkConfig;
+    config.buffers = constrain(config.buffers, 2, FILE_SINK_MAX_BUFFERS);
+    file = fs.open(path, FILE_WRITE);
+    if (!file) return false;
+    header = currentRecordingHeader();
+    header.sampleRate = sampleRate; // The rate being recorded now, not voltageBuffer's
+    header.count = 0; // Marks the file as unfinished until fileSinkEnd()
+    if (config.aligned) {
+        header.dataOffset = SD_SECTOR_BYTES; // Header takes a whole sector, so blocks start sector-aligned
+        header.flags |= RECORDING_FLAG_PADDED;
+    }
+    uint8_t raw[SD_SECTOR_BYTES] = {};
+    encodeRecordingHeader(raw, header);
+    if (file.write(raw, header.dataOffset) != header.dataOffset) {
+        file.close();
+        return false;
+    }
+    xQueueReset(freeQueue);
+    xQueueReset(fullQueue);
+    for (uint8_t i = 0; i < config.buffers; i++) xQueueSend(freeQueue, &i, 0);
+    filling = -1;
+    expectedIndex = 0;
+    writtenCount = 0;
+    committedCount = 0;
+    droppedCount = 0;
+    droppedBlocks = 0;
+    blockCount = 0;
+    syncCount = 0;
+    maxWriteMicros = 0;
+    writeFailed = false;
+    active = true;
+    return true;
+}
+
+void fileSinkService() {
+    if (!active) return;
+    LiveSample live;
+    if (filling < 0) nextBuffer();
+    while (filling >= 0 && liveRing.pop(live)) {
+        watchSample(live);
+        if (live.index != expectedIndex) {
+            // liveRing overflowed: start a new chunk so every chunk stays contiguous
+            droppedCount += live.index - expectedIndex;
+            nextBuffer();
+        }
+        SinkBuffer &buffer = buffers[filling];
+        if (buffer.count == 0) buffer.firstIndex = live.index;
+        buffer.samples[buffer.count++] = live.sample;
+        expectedIndex = live.index + 1;
+        writtenCount++;
+        if (buffer.count == CHUNK_SAMPLES) nextBuffer();
+    }
+}
+
+void fileSinkEnd() {
+    if (!active) return;
+    // The sampler is stopped, so liveRing only holds the last few samples
+    while (liveRing.size() > 0) {
+        fileSinkService();
+        delay(1);
+    }
+    submitBuffer();
+    while (uxQueueMessagesWaiting(freeQueue) < config.buffers) delay(1); // Writer finished
+    header.count = committedCount;
+    header.dropped = droppedCount;
+    uint8_t raw[RECORDING_HEADER_BYTES];
+    encodeRecordingHeader(raw, header);
+    file.seek(0);
+    file.write(raw, sizeof(raw));
+    file.close();
+    syncCount = syncCount + 1;
+    active = false;
+}
+
+bool fileSinkActive() {
+    return active;
+}
+
+bool fileSinkFailed() {
+    return writeFailed;
+}
+
+uint32_t fileSinkWritten() {
+    return writtenCount;
+}
+
+uint32_t fileSinkDropped() {
+    return droppedCount;
+}
+
+uint32_t fileSinkBlocks() {
+    return blockCount;
+}
+
+uint32_t fileSinkDroppedBlocks() {
+    return droppedBlocks;
+}
+
+uint32_t fileSinkSyncs() {
+    return syncCount;
+}
+
+uint32_t fileSinkMaxWriteMicros() {
+    return maxWriteMicros;
+}
@@ -0,0 +1,43 @@
+// =============================
+// Binary Serial Framing
+// =============================
+
+#include "frame.h"
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t length) {
+    while (length--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+size_t encodeFrame(uint8_t *out, uint8_t type, const uint8_t *payload, uint16_t length) {
+    uint8_t *p = out;
+    p = putU8(p, FRAME_SYNC_0);
+    p = putU8(p, FRAME_SYNC_1);
+    p = putU8(p, type);
+    p = putU16(p, length);
+    memcpy(p, payload, length);
+    p += length;
+    putU16(p, crc16Update(0xFFFF, out + 2, 3 + length));
+    return FRAME_BYTES(length);
+}
+
+void sendFrame(uint8_t type, const uint8_t *payload, uint16_t length) {
+    uint8_t header[5];
+    uint8_t *p = header;
+    p = putU8(p, FRAME_SYNC_0);
+    p = putU8(p, FRAME_SYNC_1);
+    p = putU8(p, type);
+    p = putU16(p, length);
+    uint16_t crc = crc16Update(0xFFFF, header + 2, 3);
+    crc = crc16Update(crc, payload, length);
+    uint8_t trailer[2];
+    putU16(trailer, crc);
+    Serial.write(header, sizeof(header));
+    Serial.write(payload, length);
+    Serial.write(trailer, sizeof(trailer));
+}
@@ -0,0 +1,164 @@
+// =============================
+// Replay Interpolation and Dither
+// =============================
+
+#include "interpolator.h"
+#include "const_math.h"
+#include <array>
+
+InterpMode interpMode = INTERP_HOLD;
+DitherMode ditherMode = DITHER_OFF;
+
+// -----------------------------
+// Compile-time polyphase coefficients
+// -----------------------------
+// Phase p holds the taps for a point p / INTERP_PHASES of the way from
+// history[CENTER - 1] to history[CENTER]: a Blackman-windowed sinc spanning
+// INTERP_TAPS samples, in Q14. Phase INTERP_PHASES (the next sample itself) is
+// included so every interval can blend between two neighbouring phases. Each
+// phase is trimmed to a DC gain of exactly 1 on its largest tap.
+
+#define INTERP_CENTER (INTERP_TAPS / 2)
+#define INTERP_ONE 16384    // 1.0 in Q14
+
+typedef std::array<std::array<int16_t, INTERP_TAPS>, INTERP_PHASES + 1> PolyphaseTable;
+
+static constexpr PolyphaseTable makePolyphase() {
+    PolyphaseTable table{};
+    for (int p = 0; p <= INTERP_PHASES; p++) {
+        int32_t sum = 0;
+        int largest = 0;
+        for (int k = 0; k < INTERP_TAPS; k++) {
+            double x = (double)p / INTERP_PHASES - (k - (INTERP_CENTER - 1)); // Distance from the tap (samples)
+            double sinc = x == 0 ? 1.0 : constSin(kPi * x) / (kPi * x);
+            double w = x / INTERP_CENTER; // -1..1 across the window
+            double window = w <= -1 || w >= 1 ? 0.0 : 0.42 + 0.5 * constCos(kPi * w) + 0.08 * constCos(2 * kPi * w);
+            double v = sinc * window * INTERP_ONE;
+            table[p][k] = (int16_t)(v + (v >= 0 ? 0.5 : -0.5));
+            sum += table[p][k];
+            if (table[p][k] > table[p][largest]) largest = k;
+        }
+        table[p][largest] += INTERP_ONE - sum;
+    }
+    return table;
+}
+
+static constexpr PolyphaseTable polyphase = makePolyphase();
+
+// -----------------------------
+// Fixed-point output stage
+// -----------------------------
+#define DAC_Q8_SCALE 32410  // 255 * 256 / SAMPLE_FULL_SCALE in Q14: sample units -> DAC code with 8 fraction bits
+
+const char *interpName(InterpMode mode) {
+    switch (mode) {
+        case INTERP_LINEAR: return "linear";
+        case INTERP_FIR: return "fir";
+        default: return "hold";
+    }
+}
+
+const char *ditherName(DitherMode mode) {
+    switch (mode) {
+        case DITHER_TPDF: return "tpdf";
+        case DITHER_SHAPED: return "shaped";
+        default: return "off";
+    }
+}
+
+// Input samples the mode keeps in history
+static inline int windowSize(InterpMode mode) {
+    return mode == INTERP_FIR ? INTERP_TAPS : (mode == INTERP_LINEAR ? 2 : 1);
+}
+
+void interpBegin(InterpState &state, InterpMode mode, DitherMode dither, uint32_t seed) {
+    state.mode = mode;
+    state.dither = dither;
+    memset(state.history, 0, sizeof(state.history));
+    state.primed = false;
+    state.pending = 0;
+    state.error = 0;
+    state.noise = seed ? seed : 1;
+}
+
+bool interpPush(InterpState &state, sample_t sample) {
+    int size = windowSize(state.mode);
+    int32_t value = sample > SAMPLE_FULL_SCALE ? SAMPLE_FULL_SCALE : sample;
+    if (!state.primed) {
+        // Start from a steady level rather than ringing up from 0 V, and swallow
+        // the pushes that only move the first sample towards the centre
+        for (int k = 0; k < size; k++) state.history[k] = value;
+        state.primed = true;
+        state.pending = max(size / 2 - 1, 0);
+        return size == 1;
+    }
+    memmove(state.history, state.history + 1, (size - 1) * sizeof(int32_t));
+    state.history[size - 1] = value;
+    if (state.pending > 0) {
+        state.pending--;
+        return false;
+    }
+    return true;
+}
+
+int interpDelay(const InterpState &state) {
+    return windowSize(state.mode) / 2;
+}
+
+// FIR output for one phase, in sample units Q14
+static inline int32_t firPhase(const int32_t *history, int phase) {
+    const std::array<int16_t, INTERP_TAPS> &taps = polyphase[phase];
+    int32_t sum = 0;
+    for (int k = 0; k < INTERP_TAPS; k++) sum += taps[k] * history[k];
+    return sum;
+}
+
+// Quantise a Q8 DAC code to 8 bits with the state's dither
+static inline uint8_t quantise(InterpState &state, int32_t codeQ8) {
+    if (state.dither != DITHER_OFF) {
+        state.noise ^= state.noise << 13;
+        state.noise ^= state.noise >> 17;
+        state.noise ^= state.noise << 5;
+        int32_t dither = (int32_t)(state.noise & 0xFF) + (int32_t)((state.noise >> 8) & 0xFF) - 255; // Triangular, +-1 code
+        if (state.dither == DITHER_SHAPED) codeQ8 -= state.error;
+        int32_t code = constrain((codeQ8 + dither + 128) >> 8, 0, 255);
+        if (state.dither == DITHER_SHAPED) state.error = constrain((code << 8) - codeQ8, -512, 512); // Bounded at the rails
+        return (uint8_t)code;
+    }
+    return (uint8_t)constrain((codeQ8 + 128) >> 8, 0, 255);
+}
+
+void interpRender(InterpState &state, uint32_t position, uint32_t step, size_t count, uint16_t *out, size_t stride) {
+    const int32_t *h = state.history;
+    if (state.mode == INTERP_HOLD) {
+        if (state.dither == DITHER_OFF) {
+            uint16_t code = (uint16_t)sampleToDacCode(h[0]) << 8; // Same codes as before interpolation existed
+            for (size_t i = 0; i < count; i++) out[i * stride] = code;
+        } else {
+            int32_t codeQ8 = (h[0] * DAC_Q8_SCALE) >> 14;
+            for (size_t i = 0; i < count; i++) out[i * stride] = (uint16_t)quantise(state, codeQ8) << 8;
+        }
+        return;
+    }
+    int32_t from = 0;
+    int32_t to = 0;
+    int phase = -1;
+    for (size_t i = 0; i < count; i++, position += step) {
+        int32_t valueQ14;
+        if (state.mode == INTERP_LINEAR) {
+            valueQ14 = (h[0] << 14) + (int32_t)(((int64_t)(h[1] - h[0]) * (position >> 16)) >> 2);
+        } else {
+            int p = position >> 27; // 32 - log2(INTERP_PHASES)
+            if (p != phase) {
+                phase = p;
+                from = firPhase(h, phase);
+                to = firPhase(h, phase + 1);
+            }
+            uint32_t blend = (position >> 11) & 0xFFFF; // Fraction between the two phases (Q16)
+            valueQ14 = from + (int32_t)(((int64_t)(to - from) * blend) >> 16);
+        }
+        if (valueQ14 < 0) valueQ14 = 0; // Ringing below 0 V
+        int32_t codeQ8 = (int32_t)(((int64_t)valueQ14 * DAC_Q8_SCALE) >> 28);
+        out[i * stride] = (uint16_t)quantise(state, codeQ8) << 8;
+    }
+}
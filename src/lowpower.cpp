@@ -0,0 +1,96 @@
+// =============================
+// Low-Power Logging ('log')
+// =============================
+
+#include "lowpower.h"
+#include "recorder.h"
+#include "storage.h"
+#include <esp_sleep.h>
+#include <driver/uart.h>
+
+static LowPowerStats stats;
+static sample_t batch[LOWPOWER_BATCH];      // Kept in RAM through light sleep
+static uint8_t chunk[CHUNK_BYTES(LOWPOWER_BATCH)];
+
+// Append one batch as a chunk and commit it
+static bool writeBatch(fs::File &file, uint32_t firstIndex, size_t count) {
+    size_t bytes = encodeChunk(chunk, firstIndex, batch, count);
+    if (file.write(chunk, bytes) != bytes) return false;
+    file.flush();
+    stats.batches++;
+    return true;
+}
+
+bool lowPowerLog(fs::FS &fs, const char *path, int rateHz) {
+    fs::File file = fs.open(path, FILE_WRITE);
+    if (!file) return false;
+    RecordingHeader header = currentRecordingHeader();
+    header.sampleRate = rateHz;
+    header.count = 0; // Unfinished until logging stops
+    header.chunkSamples = LOWPOWER_BATCH;
+    uint8_t raw[RECORDING_HEADER_BYTES];
+    encodeRecordingHeader(raw, header);
+    if (file.write(raw, sizeof(raw)) != sizeof(raw)) {
+        file.close();
+        return false;
+    }
+    file.flush();
+
+    memset(&stats, 0, sizeof(stats));
+    uint32_t savedMhz = getCpuFrequencyMhz();
+    Serial.flush();
+    setCpuFrequencyMhz(LOWPOWER_CPU_MHZ);
+    uart_set_wakeup_threshold(UART_NUM_0, 3); // A keypress (a few RX edges) wakes the chip
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    while (Serial.available()) Serial.read();
+
+    uint32_t periodMicros = 1000000UL / rateHz;
+    int64_t start = esp_timer_get_time();
+    int64_t awakeSince = start;
+    uint32_t index = 0;
+    size_t filled = 0;
+    bool stop = false;
+    while (!stop) {
+        int64_t due = start + (int64_t)((uint64_t)index * 1000000 / rateHz); // Exact even when the period is not whole microseconds
+        int64_t now = esp_timer_get_time();
+        if (due - now > LOWPOWER_WAKE_EARLY_US) {
+            stats.awakeMicros += now - awakeSince;
+            esp_sleep_enable_timer_wakeup(due - now - LOWPOWER_WAKE_EARLY_US);
+            esp_light_sleep_start();
+            awakeSince = esp_timer_get_time();
+            if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UART) break;
+        }
+        while (esp_timer_get_time() < due) {} // Sub-millisecond wait to the exact sample time
+        if (esp_timer_get_time() - due > periodMicros) stats.late++;
+        batch[filled++] = readSampleHighPrecision();
+        index++;
+        if (filled == LOWPOWER_BATCH) {
+            if (!writeBatch(file, index - filled, filled)) {
+                stats.writeFailed = true;
+                break;
+            }
+            filled = 0;
+        }
+        stop = Serial.available() > 0;
+    }
+    int64_t end = esp_timer_get_time();
+    stats.awakeMicros += end - awakeSince;
+    stats.totalMicros = end - start;
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_UART);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+    setCpuFrequencyMhz(savedMhz);
+    while (Serial.available()) Serial.read(); // The key that stopped logging
+
+    if (filled > 0 && !stats.writeFailed && !writeBatch(file, index - filled, filled)) stats.writeFailed = true;
+    stats.samples = stats.writeFailed ? stats.batches * LOWPOWER_BATCH : index; // Only full batches precede a failed write
+    header.count = stats.samples;
+    encodeRecordingHeader(raw, header);
+    file.seek(0);
+    file.write(raw, sizeof(raw));
+    file.close();
+    return true;
+}
+
+const LowPowerStats &lowPowerStats() {
+    return stats;
+}
@@ -15,73 +15,92 @@
 #include <driver/adc.h>      // ESP32 ADC driver for analog input
 #include <esp_adc_cal.h>     // ESP32 ADC calibration for accurate readings
 #include <driver/dac.h>      // ESP32 DAC driver for analog output
-
-// =============================
-// Pin Definitions
-// =============================
-#define ADC_PIN 36          // GPIO36 (ADC1_CH0) - Connect your voltage source here (0-3.3V max!)
-#define DAC_PIN 25          // GPIO25 (DAC1) - Outputs recorded voltages for replay
-#define LED_PIN 2           // Built-in LED for status indication
-
-// =============================
-// ADC (Analog to Digital Converter) Configuration
-// =============================
-#define ADC_VREF 1000       // Reference voltage in mV (used for calibration)
-
-// =============================
-// Recording Settings
-// =============================
-#define MAX_SAMPLES 5000    // Maximum number of samples to store in memory (about 20KB)
-#define BASELINE_SAMPLE_RATE 60 // Baseline sample rate in Hz
-#define BASELINE_ADC_SAMPLES 32  // Baseline ADC samples per reading
-#define DEFAULT_SAMPLE_RATE BASELINE_SAMPLE_RATE // Default sample rate in Hz (samples per second)
+#include "recorder.h"        // Pin definitions, recording settings and shared state
+#include "console.h"         // Text output (Serial, mirrored to a network client)
+#include "sampler.h"         // Hardware-timer-driven sampling engine
+#include "sample_arena.h"    // Runtime-sized sample storage
+#include "stream.h"          // Binary record-to-serial streaming
+#include "dump.h"            // Bulk binary export
+#include "replay.h"          // DMA-paced DAC replay
+#include "decimator.h"       // Fast mode decimation filters
+#include "calibration.h"     // Raw -> voltage lookup table
+#include "command.h"         // Non-blocking command parser
+#include "trigger.h"         // Triggered (pre/post) capture
+#include "compress.h"        // Delta/RLE compressed recording
+#include "storage.h"         // Recording files on LittleFS
+#include "file_sink.h"       // Record straight to a file
+#include "sd_card.h"         // SD card recording backend
+#include "channels.h"        // Multi-channel input selection
+#include "timing.h"          // Sample timing instrumentation
+#include "bench.h"           // On-device benchmarks
+#include "oversampling.h"    // 'samples auto'
+#include "interpolator.h"    // Replay interpolation and dither
+#include "lowpower.h"        // Light-sleep logging
+#include "net.h"             // Optional Wi-Fi commands and UDP streaming
+#include "spectrum.h"        // FFT analysis of the recording
+#include "watch.h"           // Inline event detection
+#include "envelope.h"        // Min/max overview of the recording
+#include <LittleFS.h>
 
 // =============================
 // Global Variables
 // =============================
-bool recording = false;                 // True if currently recording
-float voltageBuffer[MAX_SAMPLES];       // Buffer to store recorded voltages
-int sampleCount = 0;                    // Number of samples recorded
-int sampleRate = BASELINE_SAMPLE_RATE;   // Current sample rate in Hz
-unsigned long lastSampleTime = 0;       // Timestamp of last sample
+volatile bool recording = false;        // True if currently recording
+sample_t *voltageBuffer = nullptr;      // Buffer to store recorded voltages (0.1 mV units)
+int maxSamples = 0;                     // Capacity of voltageBuffer (sized at startup from free memory)
+volatile int sampleCount = 0;           // Number of samples recorded (written by the acquisition task)
+int channelCount = 1;                   // Channels per frame ('channels')
+adc1_channel_t channelList[MAX_CHANNELS] = { (adc1_channel_t)adc1ChannelOf(ADC_PIN) }; // ADC1 channel of each slot (ADC_PIN by default)
+int sampleRate = DEFAULT_SAMPLE_RATE;    // Current sample rate in Hz
+int recordedRate = DEFAULT_SAMPLE_RATE;  // Rate the samples in voltageBuffer were captured at
 esp_adc_cal_characteristics_t adc_chars;// ADC calibration characteristics
 unsigned long recordingStartTime = 0; // Time when recording started (ms)
 unsigned long recordingEndTime = 0;   // Time when recording ended (ms)
 float adcOffset = 0.0; // ADC offset (in volts) measured during calibration
+uint32_t adcOffsetUnits = 0; // ADC offset in sample_t units (0.1 mV)
 int adcSamples = BASELINE_ADC_SAMPLES;      // Oversampling: number of samples per reading for better precision (now variable)
-
-// =============================
-// Function Declarations
-// =============================
-void setupADC();
-void setupDAC();
-float readVoltageHighPrecision();
-void processSerialCommands();
-void startRecording();
-void stopRecording();
-void replayVoltages();
-void printStatus();
-void printHelp();
-void printData();
-void calibrateADCOffset();
+AcquisitionMode acqMode = DEFAULT_ACQ_MODE; // Precise (timer + oversampling) or fast (I2S DMA) acquisition
+FilterType filterType = FILTER_CIC;     // Fast mode decimation filter
+uint32_t serialBaud = DEFAULT_BAUD_RATE; // Current serial baud rate (changed with 'baud')
+int lastReportedCount = 0;              // Sample count at the last progress message
+bool replayReported = true;             // Summary of the last background replay has been printed
+bool triggerArmed = false;              // Current recording is a triggered capture ('arm')
+bool triggerReported = false;           // "Triggered" message printed for the current capture
+bool remoteCommand = false;             // The command being run came from the network client (net.h)
 
 // =============================
 // Arduino Setup Function
 // =============================
+// The test suite (test/) builds this file for its globals and functions but
+// brings its own setup() and loop()
+#ifndef PIO_UNIT_TESTING
 void setup() {
-    Serial.begin(115200);   // Start serial communication at 115200 baud
+    Serial.setTxBufferSize(4096); // Room for binary frames so loop() rarely waits on the UART
+    Serial.begin(DEFAULT_BAUD_RATE); // Start serial communication at 115200 baud
     delay(1000);            // Wait for serial to initialize
     pinMode(LED_PIN, OUTPUT);           // Set LED pin as output
     digitalWrite(LED_PIN, LOW);         // Turn off LED initially
-    Serial.println("=== ESP32 Simple Voltage Recorder ===");
-    Serial.printf("Version: %s\n", VERSION);
-    Serial.println("Initializing...");
+    console.println("=== ESP32 Simple Voltage Recorder ===");
+    console.printf("Version: %s (%s build)\n", VERSION, BUILD_PROFILE);
+    console.println("Initializing...");
+#ifdef DEFAULT_CHANNEL_MASK
+    if (!setChannelMask(DEFAULT_CHANNEL_MASK)) { // Profile records several inputs from power-up
+        console.printf("ERROR: DEFAULT_CHANNEL_MASK 0x%02X is not usable, recording ADC_PIN only\n", DEFAULT_CHANNEL_MASK);
+    }
+#endif
     setupADC();    // Set up ADC for voltage readings
+    buildCalibrationLut(); // Raw code -> voltage table (offset is folded in after calibration)
     setupDAC();    // Set up DAC for voltage replay
-    Serial.println("Auto-calibrating ADC offset.");
+    setupSampler(); // Set up the hardware sample timer and acquisition task
+    allocateSampleArena(ARENA_MAX_KB); // Size the sample buffer from free memory
+    storageBegin(); // Mount LittleFS for save/load
+    if (sdBegin()) printSdInfo(); // Optional SD card for long recordings
+    netBegin();    // Join Wi-Fi in the background (only when built with WIFI_SSID)
+    console.println("Auto-calibrating ADC offset.");
     delay(1000); // Wait 1 second for user to connect pin to GND
     calibrateADCOffset();
-    Serial.println("Setup complete!");
+    measureAdcReadCost(); // Budget for 'samples auto'
+    console.println("Setup complete!");
     printHelp();   // Show available commands
     digitalWrite(LED_PIN, HIGH); // Turn on LED to indicate ready
 }
@@ -91,30 +110,48 @@ void setup() {
 // =============================
 void loop() {
     processSerialCommands(); // Check for serial commands from user
-    // If recording is active, take samples at the specified rate
-    if (recording && sampleCount < MAX_SAMPLES) {
-        unsigned long currentTime = millis();
-        if (sampleCount == 0) recordingStartTime = currentTime; // Mark start time
-        // Check if it's time for the next sample
-        if (currentTime - lastSampleTime >= (1000 / sampleRate)) {
-            voltageBuffer[sampleCount] = readVoltageHighPrecision(); // Store voltage in buffer
-            sampleCount++;
-            lastSampleTime = currentTime;
-            // Blink LED during recording (visual feedback)
-            digitalWrite(LED_PIN, (sampleCount % 100 < 50) ? HIGH : LOW);
-            // Print progress every 100 samples
-            if (sampleCount % 100 == 0) {
-                Serial.printf("Recorded %d samples...\n", sampleCount);
-            }
-            // If buffer is full, stop recording automatically
-            if (sampleCount >= MAX_SAMPLES) {
-                Serial.println("Buffer full! Stopping recording.");
-                stopRecording();
+    reportReplayFinished();  // Summarise a background replay once it ends
+    // Samples are taken by the acquisition task on the other core; loop() only follows them
+    if (streamActive()) {
+        streamService(); // Streaming consumes liveRing itself
+        lastReportedCount = streamSent();
+    } else if (netStreamActive()) {
+        lastReportedCount = netStreamSent(); // The network task consumes liveRing
+    } else if (fileSinkActive()) {
+        fileSinkService(); // So does recording to a file
+        lastReportedCount = fileSinkWritten();
+    } else {
+        LiveSample live;
+        while (liveRing.pop(live)) {
+            watchSample(live);
+            int count = live.index + 1;
+            // Print progress every 100 samples (an armed trigger can wait for hours, so stay quiet)
+            if (count % 100 == 0 && !triggerArmed) {
+                console.printf("Recorded %d samples...\n", count);
             }
+            lastReportedCount = count;
+        }
+    }
+    watchService(); // Report events as soon as the detectors raise them
+    if (recording) {
+        // Blink LED during recording (visual feedback)
+        digitalWrite(LED_PIN, (lastReportedCount % 100 < 50) ? HIGH : LOW);
+        if (triggerArmed && !triggerReported && samplerTriggered()) {
+            triggerReported = true;
+            console.printf("Triggered at sample %u, capturing %u post-trigger samples...\n", (unsigned)samplerTriggerIndex(), (unsigned)triggerPostSamples());
+        }
+        // If buffer (or file system) is full, stop recording automatically
+        if (fileSinkActive() && fileSinkFailed()) {
+            console.println("Storage full! Stopping recording.");
+            stopRecording();
+        } else if (samplerBufferFull()) {
+            console.println(triggerArmed ? "Trigger capture complete." : "Buffer full! Stopping recording.");
+            stopRecording();
         }
     }
     delay(1); // Small delay to avoid busy loop
 }
+#endif // PIO_UNIT_TESTING
 
 // =============================
 // ADC Setup
@@ -123,17 +160,17 @@ void setupADC() {
     // Configure ADC1 for 12-bit resolution (0-4095)
     adc1_config_width(ADC_WIDTH_BIT_12);
     // Set attenuation to 11dB for full 0-3.3V range
-    adc1_config_channel_atten(ADC1_CHANNEL_0, ADC_ATTEN_11db);
+    adc1_config_channel_atten(channelList[0], ADC_ATTEN_11db);
     
     // Calibrate ADC for accurate readings
     esp_adc_cal_value_t val_type = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_11db, ADC_WIDTH_BIT_12, ADC_VREF, &adc_chars);
     
     if (val_type == ESP_ADC_CAL_VAL_EFUSE_VREF) {
-        Serial.println("ADC: Using eFuse Vref");
+        console.println("ADC: Using eFuse Vref");
     } else if (val_type == ESP_ADC_CAL_VAL_EFUSE_TP) {
-        Serial.println("ADC: Using eFuse Two Point");
+        console.println("ADC: Using eFuse Two Point");
     } else {
-        Serial.println("ADC: Using Default Vref");
+        console.println("ADC: Using Default Vref");
     }
 }
 
@@ -145,105 +182,798 @@ void setupDAC() {
     dac_output_enable(DAC_CHANNEL_1);
     // Set DAC output to 0V initially
     dac_output_voltage(DAC_CHANNEL_1, 0);
-    Serial.println("DAC initialized for voltage replication");
+    console.println("DAC initialized for voltage replication");
 }
 
 // =============================
 // High-Precision Voltage Reading
 // =============================
 float readVoltageHighPrecision() {
+    return sampleToVolts(readSampleHighPrecision());
+}
+
+// Oversampled reading of one channel slot in sample_t units (integer math only)
+sample_t readSampleHighPrecision(int slot) {
+    adc1_channel_t channel = channelList[slot];
     uint32_t total = 0;
     // Take multiple samples and average them for better accuracy
     for (int i = 0; i < adcSamples; i++) {
-        total += adc1_get_raw(ADC1_CHANNEL_0); // Read raw ADC value
+        total += adc1_get_raw(channel); // Read raw ADC value
         delayMicroseconds(10); // Small delay between samples
     }
-    uint32_t average = total / adcSamples;
-    // Convert raw ADC value to millivolts using calibration
-    uint32_t voltage_mv = esp_adc_cal_raw_to_voltage(average, &adc_chars);
-    float voltage = voltage_mv / 1000.0; // Convert to volts
-    // Subtract offset
-    voltage -= adcOffset;
-    if (voltage < 0) voltage = 0.0; // Clamp to zero
-    return voltage;
+    // Keep RAW_FRAC_BITS of the average instead of discarding them in the division
+    uint32_t average = ((total << RAW_FRAC_BITS) + adcSamples / 2) / adcSamples;
+    return rawToChannelSample(average, slot);
 }
 
-// Calibrate ADC offset (call with pin grounded)
+// Current input voltage. While recording, the acquisition task owns ADC1, so
+// report its most recent sample instead of competing with it for the ADC.
+float currentVoltage() {
+    if (recording) {
+        RunningStats stats;
+        samplerGetStats(stats);
+        return sampleToVolts(stats.latest);
+    }
+    return readVoltageHighPrecision();
+}
+
+// Calibrate ADC offset (call with pin grounded). With several channels each
+// input gets its own offset, so all of them must be grounded.
 void calibrateADCOffset() {
-    Serial.println("Make sure the ADC pin is connected to GND during calibration.");
-    uint32_t total = 0;
-    for (int i = 0; i < adcSamples; i++) {
-        total += adc1_get_raw(ADC1_CHANNEL_0);
-        delayMicroseconds(10);
+    console.println(channelCount > 1 ? "Make sure every recorded ADC pin is connected to GND during calibration."
+                                    : "Make sure the ADC pin is connected to GND during calibration.");
+    for (int slot = 0; slot < channelCount; slot++) {
+        uint32_t total = 0;
+        for (int i = 0; i < adcSamples; i++) {
+            total += adc1_get_raw(channelList[slot]);
+            delayMicroseconds(10);
+        }
+        uint32_t average = ((total << RAW_FRAC_BITS) + adcSamples / 2) / adcSamples;
+        if (slot == 0) {
+            setGroundCalibration(average); // Folds the offset into the conversion table
+        } else {
+            setChannelOffset(slot, average); // Relative to the first channel
+        }
+    }
+    console.printf("ADC offset calibrated: %.4f V\n", adcOffset);
+    for (int slot = 1; slot < channelCount; slot++) {
+        console.printf("  GPIO%d: %.4f V\n", channelGpio(channelList[slot]), adcOffset + (float)channelOffsetUnits[slot] / SAMPLE_UNITS_PER_VOLT);
     }
-    uint32_t average = total / adcSamples;
-    uint32_t voltage_mv = esp_adc_cal_raw_to_voltage(average, &adc_chars);
-    adcOffset = voltage_mv / 1000.0;
-    Serial.printf("ADC offset calibrated: %.4f V\n", adcOffset);
 }
 
 // =============================
 // Serial Command Processing
 // =============================
-void processSerialCommands() {
-    if (Serial.available()) {
-        String command = Serial.readStringUntil('\n'); // Read command from serial
-        command.trim();
-        command.toLowerCase();
-        // Check which command was entered
-        if (command.startsWith("start") || command.startsWith("begin")) {
-            startRecording();
+// Each handler gets the tokenized line (argv[0] is the command word).
+
+static void cmdStart(int argc, char **argv) {
+    startRecording();
+}
+
+static void cmdStop(int argc, char **argv) {
+    if (replayActive()) {
+        replayStop();
+        reportReplayFinished();
+    } else {
+        stopRecording();
+    }
+}
+
+// While recording to a file, loop() is what moves samples from liveRing into
+// the sink, so a command that holds it for long would leave holes in the file
+static bool fileSinkBusy(const char *command) {
+    if (!fileSinkActive()) return false;
+    console.printf("'%s' would hold up the file being recorded. Stop recording first.\n", command);
+    return true;
+}
+
+static void cmdShow(int argc, char **argv) {
+    if (fileSinkBusy("show")) return;
+    printData();
+}
+
+// Binary frames and the baud handshake only ever use Serial, so these commands
+// would act on the USB link instead of the network client that sent them
+static bool serialOnly(const char *command) {
+    if (!remoteCommand) return false;
+    console.printf("'%s' acts on the USB serial link, so it only works from there.\n", command);
+    return true;
+}
+
+static void cmdDump(int argc, char **argv) {
+    if (serialOnly("dump")) return;
+    if (recording) {
+        console.println("Stop recording before dumping.");
+    } else if (sampleCount == 0) {
+        console.println("No data recorded!");
+    } else {
+        dumpBuffer();
+    }
+}
+
+// overview <points>: min/max envelope of the whole recording, also while it is still being recorded
+static void cmdOverview(int argc, char **argv) {
+    if (serialOnly("overview")) return;
+    long points;
+    if (argc < 2 || !parseInteger(argv[1], points) || points < 1 || points > ENVELOPE_MAX_POINTS) {
+        console.printf("Usage: overview <points: 1-%d>\n", ENVELOPE_MAX_POINTS);
+        return;
+    }
+    if (!recording && envelopeFrames() != (uint32_t)frameCount()) envelopeRebuild(); // The buffer was filled some other way
+    if (frameCount() == 0 || !sendOverview(points)) console.println("No data recorded!");
+}
+
+// range <start> <end>: frames [start, end) as a dump
+static void cmdRange(int argc, char **argv) {
+    if (serialOnly("range")) return;
+    if (fileSinkBusy("range")) return;
+    long start, end;
+    long frames = frameCount();
+    if (argc < 3 || !parseInteger(argv[1], start) || !parseInteger(argv[2], end) || start < 0 || end <= start) {
+        console.println("Usage: range <start frame> <end frame> (end not included)");
+    } else if (recording && storageCompressed) {
+        console.println("Stop recording before reading a compressed recording.");
+    } else if (end > frames) {
+        console.printf("Only %ld frames are recorded.\n", frames);
+    } else {
+        dumpFrames(start, end - start);
+    }
+}
+
+static void cmdReplay(int argc, char **argv) {
+    // replay = once, replay <n> = n times, replay loop = until 'stop', replay speed <x> = playback speed
+    long passes;
+    float speed;
+    if (argc > 1 && strcmp(argv[1], "speed") == 0) {
+        if (argc < 3) {
+            console.printf("Replay speed: %.2fx\n", (float)replaySpeed() / REPLAY_SPEED_ONE);
+        } else if (replayActive()) {
+            console.println("Stop the replay before changing its speed.");
+        } else if (!parseNumber(argv[2], speed) || speed < 0.1 || speed > 10) {
+            console.println("Invalid replay speed (0.1-10)");
+        } else {
+            replaySetSpeed((uint32_t)(speed * REPLAY_SPEED_ONE + 0.5));
+            console.printf("Replay speed: %.2fx\n", (float)replaySpeed() / REPLAY_SPEED_ONE);
         }
-        else if (command.startsWith("stop")) {
-            stopRecording();
+    } else if (argc < 2) {
+        replayVoltages(1);
+    } else if (strcmp(argv[1], "loop") == 0) {
+        replayVoltages(REPLAY_LOOP_FOREVER);
+    } else if (parseInteger(argv[1], passes) && passes >= 1) {
+        replayVoltages(passes);
+    } else {
+        console.println("Usage: replay [loop|<count>|speed <x>]");
+    }
+}
+
+static void cmdArm(int argc, char **argv) {
+    startTriggeredRecording();
+}
+
+// trigger [off | above|below|rising|falling <V> | window <low V> <high V> | pre <N> | post <N>]
+static void cmdTrigger(int argc, char **argv) {
+    static const TriggerType levelTypes[] = { TRIG_ABOVE, TRIG_BELOW, TRIG_RISING, TRIG_FALLING };
+    if (recording) {
+        console.println("Stop recording before changing the trigger.");
+        return;
+    }
+    if (argc < 2) {
+        printTriggerConfig();
+        return;
+    }
+    float low, high;
+    long count;
+    if (strcmp(argv[1], "off") == 0) {
+        triggerConfig.type = TRIG_OFF;
+    } else if (strcmp(argv[1], "window") == 0) {
+        if (argc < 4 || !parseNumber(argv[2], low) || !parseNumber(argv[3], high) || low < 0 || high > 3.3 || low >= high) {
+            console.println("Usage: trigger window <low V> <high V> (0-3.3)");
+            return;
         }
-        else if (command.startsWith("show") || command.startsWith("print")) {
-            printData();
+        triggerConfig.type = TRIG_WINDOW;
+        triggerConfig.level = (sample_t)(low * SAMPLE_UNITS_PER_VOLT + 0.5);
+        triggerConfig.high = (sample_t)(high * SAMPLE_UNITS_PER_VOLT + 0.5);
+    } else if (strcmp(argv[1], "pre") == 0 || strcmp(argv[1], "post") == 0) {
+        if (argc < 3 || !parseInteger(argv[2], count) || count < 0 || count > maxSamples) {
+            console.printf("Usage: trigger %s <samples> (0-%d)\n", argv[1], maxSamples);
+            return;
         }
-        else if (command.startsWith("replay") || command.startsWith("replicate")) {
-            replayVoltages();
+        if (argv[1][1] == 'r') triggerConfig.pre = count;
+        else triggerConfig.post = count;
+    } else {
+        size_t i = 0;
+        while (i < 4 && strcmp(argv[1], triggerName(levelTypes[i])) != 0) i++;
+        if (i == 4 || argc < 3 || !parseNumber(argv[2], low) || low < 0 || low > 3.3) {
+            console.println("Usage: trigger off | above|below|rising|falling <V> | window <low> <high> | pre <N> | post <N>");
+            return;
         }
-        else if (command.startsWith("status")) {
-            printStatus();
+        triggerConfig.type = levelTypes[i];
+        triggerConfig.level = (sample_t)(low * SAMPLE_UNITS_PER_VOLT + 0.5);
+    }
+    printTriggerConfig();
+}
+
+static void cmdStatus(int argc, char **argv) {
+    printStatus();
+}
+
+static void cmdClear(int argc, char **argv) {
+    if (recording) {
+        console.println("Stop recording before clearing the buffer.");
+        return;
+    }
+    sampleCount = 0;
+    storageCompressed = false;
+    samplerResetStats();
+    timingClearStamps();
+    console.println("Buffer cleared.");
+}
+
+static void cmdStream(int argc, char **argv) {
+    if (serialOnly("stream")) return; // 'net stream' is the network equivalent
+    startStreaming();
+}
+
+// net [stream <collector-ip> [port]]: network status, or stream samples over UDP
+static void cmdNet(int argc, char **argv) {
+    long port = NET_STREAM_PORT;
+    if (argc < 2) {
+        printNetInfo();
+    } else if (strcmp(argv[1], "stream") == 0 && argc >= 3 && (argc < 4 || (parseInteger(argv[3], port) && port > 0 && port <= 65535))) {
+        startNetStreaming(argv[2], port);
+    } else {
+        console.println("Usage: net [stream <collector-ip> [port]]");
+    }
+}
+
+static void cmdBaud(int argc, char **argv) {
+    if (serialOnly("baud")) return;
+    long newBaud = 0;
+    parseInteger(argc > 1 ? argv[1] : nullptr, newBaud);
+    if (recording) {
+        console.println("Stop recording before changing the baud rate.");
+    } else if (newBaud == 115200 || newBaud == 230400 || newBaud == 460800 ||
+               newBaud == 921600 || newBaud == 1500000 || newBaud == 2000000) {
+        negotiateBaudRate(newBaud);
+    } else {
+        console.println("Invalid baud rate (115200, 230400, 460800, 921600, 1500000, 2000000)");
+    }
+}
+
+// 'samples auto' follows the rate, mode and channel count as they change
+static void updateAutoSamples() {
+    if (!autoOversampling) return;
+    adcSamples = autoSamplesFor(sampleRate);
+    console.printf("ADC samples per reading: %d (auto)\n", adcSamples);
+}
+
+static void cmdRate(int argc, char **argv) {
+    long newRate;
+    if (recording) {
+        console.println("Stop recording before changing the sample rate.");
+    } else if (argc > 1 && parseInteger(argv[1], newRate) && newRate > 0 && newRate <= 10000) {
+        sampleRate = newRate;
+        console.printf("Sample rate set to %d Hz\n", sampleRate);
+        if (sampleCount > 0 && recordedRate != sampleRate) {
+            console.printf("(The buffer was recorded at %d Hz and still replays at that rate.)\n", recordedRate);
         }
-        else if (command.startsWith("clear")) {
-            sampleCount = 0;
-            Serial.println("Buffer cleared.");
+        updateAutoSamples();
+        if (sampleRate > BASELINE_SAMPLE_RATE) {
+            console.println("NOTICE: Sample rate is above baseline value. Recording and replay timing may be inaccurate!");
         }
-        else if (command.startsWith("rate")) {
-            int newRate = command.substring(5).toInt();
-            if (newRate > 0 && newRate <= 10000) {
-                sampleRate = newRate;
-                Serial.printf("Sample rate set to %d Hz\n", sampleRate);
-                if (sampleRate > BASELINE_SAMPLE_RATE) {
-                    Serial.println("NOTICE: Sample rate is above baseline value. Recording and replay timing may be inaccurate!");
-                }
-            } else {
-                Serial.println("Invalid sample rate (1-10000 Hz)");
-            }
+    } else {
+        console.println("Invalid sample rate (1-10000 Hz)");
+    }
+}
+
+static void cmdArena(int argc, char **argv) {
+    long capKB;
+    if (recording || replayActive()) {
+        console.println("Stop recording/replay before resizing the sample arena.");
+    } else if (argc < 2 || !parseInteger(argv[1], capKB) || capKB < 0) {
+        console.println("Invalid arena size (KB, 0 = all available memory)");
+    } else {
+        allocateSampleArena(capKB); // Clears the buffer
+        storageCompressed = false;
+        samplerResetStats();
+        timingClearStamps();
+        printArenaInfo();
+    }
+}
+
+static void cmdSamples(int argc, char **argv) {
+    long newSamples;
+    if (recording && argc > 1) {
+        console.println("Stop recording before changing ADC samples.");
+    } else if (argc > 1 && strcmp(argv[1], "auto") == 0) {
+        autoOversampling = true;
+        adcSamples = autoSamplesFor(sampleRate);
+        console.printf("ADC samples per reading: auto (%d at %d Hz, %.2f us per conversion)\n", adcSamples, sampleRate, adcReadMicros());
+    } else if (argc > 1 && parseInteger(argv[1], newSamples) && newSamples >= 1 && newSamples <= 1024) {
+        autoOversampling = false;
+        adcSamples = newSamples;
+        console.printf("ADC samples per reading set to %d\n", adcSamples);
+    } else {
+        console.println("Invalid ADC samples (1-1024 or auto)");
+    }
+}
+
+static void cmdMode(int argc, char **argv) {
+    const char *newMode = argc > 1 ? argv[1] : "";
+    if (recording) {
+        console.println("Stop recording before changing acquisition mode.");
+    } else if (strcmp(newMode, "fast") == 0) {
+        acqMode = ACQ_FAST;
+        console.println("Acquisition mode: fast (I2S DMA stream, 'samples' sets decimation)");
+        updateAutoSamples();
+    } else if (strcmp(newMode, "precise") == 0) {
+        acqMode = ACQ_PRECISE;
+        console.println("Acquisition mode: precise (timer-driven oversampling)");
+        updateAutoSamples();
+    } else {
+        console.println("Invalid mode (precise or fast)");
+    }
+}
+
+static void cmdFilter(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : "";
+    if (recording) {
+        console.println("Stop recording before changing the filter.");
+        return;
+    } else if (strcmp(name, "box") == 0) {
+        filterType = FILTER_BOX;
+    } else if (strcmp(name, "cic") == 0) {
+        filterType = FILTER_CIC;
+    } else if (strcmp(name, "fir") == 0) {
+        filterType = FILTER_FIR;
+    } else {
+        console.println("Invalid filter (box, cic or fir)");
+        return;
+    }
+    console.printf("Fast mode decimation filter: %s\n", filterName(filterType));
+}
+
+static void cmdInterp(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : "";
+    if (replayActive()) {
+        console.println("Stop the replay before changing interpolation.");
+        return;
+    } else if (strcmp(name, "hold") == 0) {
+        interpMode = INTERP_HOLD;
+    } else if (strcmp(name, "linear") == 0) {
+        interpMode = INTERP_LINEAR;
+    } else if (strcmp(name, "fir") == 0) {
+        interpMode = INTERP_FIR;
+    } else {
+        console.println("Invalid interpolation (hold, linear or fir)");
+        return;
+    }
+    console.printf("Replay interpolation: %s\n", interpName(interpMode));
+}
+
+static void cmdDither(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : "";
+    if (replayActive()) {
+        console.println("Stop the replay before changing dither.");
+        return;
+    } else if (strcmp(name, "off") == 0) {
+        ditherMode = DITHER_OFF;
+    } else if (strcmp(name, "tpdf") == 0) {
+        ditherMode = DITHER_TPDF;
+    } else if (strcmp(name, "shaped") == 0) {
+        ditherMode = DITHER_SHAPED;
+    } else {
+        console.println("Invalid dither (off, tpdf or shaped)");
+        return;
+    }
+    console.printf("Replay dither: %s\n", ditherName(ditherMode));
+}
+
+// channels [<gpio> ...]: show or select the ADC1 inputs recorded together
+static void cmdChannels(int argc, char **argv) {
+    if (argc < 2) {
+        console.printf("Channels (%d): ", channelCount);
+        printChannels();
+        console.println();
+        return;
+    }
+    if (recording || replayActive()) {
+        console.println("Stop recording/replay before changing channels.");
+        return;
+    }
+    if (argc - 1 > MAX_CHANNELS) {
+        console.printf("This build records at most %d channel(s).\n", MAX_CHANNELS);
+        return;
+    }
+    adc1_channel_t selected[MAX_CHANNELS];
+    long gpio;
+    for (int i = 1; i < argc; i++) {
+        if (!parseInteger(argv[i], gpio) || !gpioChannel(gpio, selected[i - 1])) {
+            console.println("Usage: channels <gpio> [<gpio> ...] (ADC1 pins 32-39)");
+            return;
         }
-        else if (command.startsWith("samples")) {
-            int newSamples = command.substring(7).toInt();
-            if (newSamples >= 1 && newSamples <= 1024) {
-                adcSamples = newSamples;
-                Serial.printf("ADC samples per reading set to %d\n", adcSamples);
-            } else {
-                Serial.println("Invalid ADC samples (1-1024)");
-            }
+    }
+    if (!setChannels(selected, argc - 1)) {
+        console.println("Each pin can only be listed once.");
+        return;
+    }
+    // The buffer layout depends on the channel count, so an old recording no longer reads correctly
+    sampleCount = 0;
+    storageCompressed = false;
+    samplerResetStats();
+    timingClearStamps();
+    console.printf("Recording %d channel(s): ", channelCount);
+    printChannels();
+    console.println("\nBuffer cleared. Run 'calibrate' with every input grounded.");
+    if (channelCount > 1) {
+        console.printf("Each frame holds %d samples, so the arena holds %d frames.\n", channelCount, maxSamples / channelCount);
+    }
+    updateAutoSamples();
+}
+
+// dac <ch> [<ch>|off]: recorded channels (1 = first) replayed on DAC1 and DAC2
+static void cmdDac(int argc, char **argv) {
+    long first, second = -1;
+    if (argc < 2) {
+        // Fall through to print the mapping
+    } else if (replayActive()) {
+        console.println("Stop the replay before changing the DAC mapping.");
+        return;
+    } else if (!parseInteger(argv[1], first) || first < 1 || first > MAX_CHANNELS ||
+               (argc > 2 && strcmp(argv[2], "off") != 0 && (!parseInteger(argv[2], second) || second < 1 || second > MAX_CHANNELS))) {
+        console.printf("Usage: dac <channel 1-%d> [<channel>|off]\n", MAX_CHANNELS);
+        return;
+    } else {
+        replaySetDacSlots(first - 1, second > 0 ? second - 1 : -1);
+    }
+    console.printf("Replay: channel %d on DAC1 (GPIO%d)", replayDacSlot(0) + 1, DAC_PIN);
+    if (replayDacSlot(1) >= 0) {
+        console.printf(", channel %d on DAC2 (GPIO%d) for multi-channel recordings\n", replayDacSlot(1) + 1, DAC2_PIN);
+    } else {
+        console.println(", DAC2 off");
+    }
+}
+
+static void cmdCompress(int argc, char **argv) {
+    const char *arg = argc > 1 ? argv[1] : "";
+    if (recording) {
+        console.println("Stop recording before changing compression.");
+        return;
+    } else if (strcmp(arg, "on") == 0) {
+        compressionEnabled = true;
+    } else if (strcmp(arg, "off") == 0) {
+        compressionEnabled = false;
+    } else {
+        console.println("Usage: compress on|off");
+        return;
+    }
+    console.printf("Compressed recording: %s (applies to the next 'start')\n", compressionEnabled ? "on" : "off");
+}
+
+static void cmdSave(int argc, char **argv) {
+    if (argc < 2) {
+        console.println("Usage: save <name>");
+    } else if (recording) {
+        console.println("Stop recording before saving.");
+    } else if (sampleCount == 0) {
+        console.println("No data recorded!");
+    } else {
+        saveRecording(argv[1]);
+    }
+}
+
+static void cmdLoad(int argc, char **argv) {
+    if (argc < 2) {
+        console.println("Usage: load <name>");
+    } else if (recording || replayActive()) {
+        console.println("Stop recording/replay before loading.");
+    } else {
+        loadRecording(argv[1]);
+    }
+}
+
+static void cmdList(int argc, char **argv) {
+    int found = listRecordings(LittleFS);
+    console.printf("%d recording(s), %.1f KB free\n", found, (LittleFS.totalBytes() - LittleFS.usedBytes()) / 1024.0);
+}
+
+static void cmdRemove(int argc, char **argv) {
+    if (argc < 2) {
+        console.println("Usage: rm <name>");
+    } else if (fileSinkActive()) {
+        console.println("Stop recording before removing files.");
+    } else {
+        removeRecording(argv[1]);
+    }
+}
+
+static void cmdRecord(int argc, char **argv) {
+    char path[RECORDING_NAME_MAX + 8];
+    if (argc < 2 || !recordingPath(argv[1], path, sizeof(path))) {
+        console.printf("Usage: record <name> (1-%d characters: letters, digits, _ or -)\n", RECORDING_NAME_MAX);
+        return;
+    }
+    FileSinkConfig config = FLASH_SINK_CONFIG;
+    startFileRecording(LittleFS, path, config);
+}
+
+// log <name>: low-power logging straight to flash
+static void cmdLog(int argc, char **argv) {
+    char path[RECORDING_NAME_MAX + 8];
+    if (argc < 2 || !recordingPath(argv[1], path, sizeof(path))) {
+        console.printf("Usage: log <name> (1-%d characters: letters, digits, _ or -)\n", RECORDING_NAME_MAX);
+        return;
+    }
+    startLowPowerLog(LittleFS, path);
+}
+
+// Replay a recording file from `fs`: argv[0] is the name, argv[1] an optional loop|N
+static void playRecording(fs::FS &fs, const char *where, int argc, char **argv) {
+    char path[RECORDING_NAME_MAX + 8];
+    long passes = 1;
+    if (argc < 1 || !recordingPath(argv[0], path, sizeof(path))) {
+        console.println("Usage: play <name> [loop|<count>]");
+        return;
+    }
+    if (argc > 1) {
+        if (strcmp(argv[1], "loop") == 0) {
+            passes = REPLAY_LOOP_FOREVER;
+        } else if (!parseInteger(argv[1], passes) || passes < 1) {
+            console.println("Usage: play <name> [loop|<count>]");
+            return;
+        }
+    }
+    if (recording) {
+        console.println("Stop recording before replaying.");
+    } else if (replayActive()) {
+        console.println("Already replaying! Type 'stop' first.");
+    } else if (!fs.exists(path)) {
+        console.printf("No recording named '%s'. Type 'ls' to list them.\n", argv[0]);
+    } else if (!replayStartFile(fs, path, passes)) {
+        console.printf("ERROR: Could not replay %s!\n", path);
+    } else {
+        console.printf("Replaying %s from %s at %u Hz, %.2fx (DAC clock %u Hz)...\n", path, where, (unsigned)replaySampleRate(),
+                      (float)replaySpeed() / REPLAY_SPEED_ONE, (unsigned)replayOutputRate());
+        console.println("Replay runs in the background. Type 'stop' to end it.\n");
+        replayReported = false;
+    }
+}
+
+// play <name> [loop|N]: replay a recording file straight from flash
+static void cmdPlay(int argc, char **argv) {
+    playRecording(LittleFS, "flash", argc - 1, argv + 1);
+}
+
+// sd [ls | record <name> | play <name> [loop|N] | log <name> | sync <N>]
+static void cmdSd(int argc, char **argv) {
+    const char *sub = argc > 1 ? argv[1] : "";
+    long blocks;
+    if (*sub == '\0') {
+        if (!recording && !replayActive()) sdBegin(); // (Re)mount, e.g. after swapping cards
+        printSdInfo();
+        return;
+    }
+    if (strcmp(sub, "sync") == 0) {
+        if (argc < 3 || !parseInteger(argv[2], blocks) || blocks < 0 || blocks > 65535) {
+            console.println("Usage: sd sync <blocks> (0 = only when the recording ends)");
+        } else {
+            sdSetSyncBlocks(blocks);
+            console.printf("SD recordings flush every %ld blocks%s\n", blocks, blocks == 0 ? " (only at the end)" : "");
+        }
+        return;
+    }
+    if (!sdMounted()) {
+        printSdInfo();
+        return;
+    }
+    char path[RECORDING_NAME_MAX + 8];
+    if (strcmp(sub, "ls") == 0) {
+        int found = listRecordings(sdFileSystem());
+        console.printf("%d recording(s) on the SD card\n", found);
+    } else if (strcmp(sub, "record") == 0) {
+        if (argc < 3 || !recordingPath(argv[2], path, sizeof(path))) {
+            console.printf("Usage: sd record <name> (1-%d characters: letters, digits, _ or -)\n", RECORDING_NAME_MAX);
+            return;
         }
-        else if (command.startsWith("read")) {
-            float voltage = readVoltageHighPrecision();
-            Serial.printf("Current voltage: %.4f V\n", voltage);
+        startFileRecording(sdFileSystem(), path, sdSinkConfig());
+    } else if (strcmp(sub, "play") == 0) {
+        playRecording(sdFileSystem(), "the SD card", argc - 2, argv + 2);
+    } else if (strcmp(sub, "log") == 0) {
+        if (argc < 3 || !recordingPath(argv[2], path, sizeof(path))) {
+            console.printf("Usage: sd log <name> (1-%d characters: letters, digits, _ or -)\n", RECORDING_NAME_MAX);
+            return;
         }
-        else if (command.startsWith("calibrate")) {
-            calibrateADCOffset();
+        startLowPowerLog(sdFileSystem(), path);
+    } else {
+        console.println("Usage: sd [ls | record <name> | play <name> [loop|N] | log <name> | sync <N>]");
+    }
+}
+
+static void cmdTiming(int argc, char **argv) {
+    printTiming();
+}
+
+// watch [level <V>|spike <V>|dropout <V> [ms]|hysteresis <V>|<detector> off|off]: inline event detection
+static void cmdWatch(int argc, char **argv) {
+    const char *what = argc > 1 ? argv[1] : "";
+    bool off = argc > 2 && strcmp(argv[2], "off") == 0;
+    float volts = 0;
+    long ms = watchConfig.dropoutMs;
+    bool valid = argc > 2 && (off || (parseNumber(argv[2], volts) && volts >= 0 && volts <= 3.3));
+    sample_t units = (sample_t)(volts * SAMPLE_UNITS_PER_VOLT + 0.5);
+    if (argc == 1) {
+        printWatchConfig();
+        return;
+    } else if (recording) {
+        console.println("Stop recording before changing watch settings.");
+        return;
+    } else if (strcmp(what, "off") == 0) {
+        watchConfig.levelOn = false;
+        watchConfig.spike = 0;
+        watchConfig.dropoutOn = false;
+    } else if (strcmp(what, "level") == 0 && valid) {
+        watchConfig.levelOn = !off;
+        watchConfig.level = units;
+    } else if (strcmp(what, "spike") == 0 && valid && (off || units > 0)) {
+        watchConfig.spike = off ? 0 : units;
+    } else if (strcmp(what, "dropout") == 0 && valid && (argc < 4 || (parseInteger(argv[3], ms) && ms >= 1 && ms <= 60000))) {
+        watchConfig.dropoutOn = !off;
+        watchConfig.dropout = units;
+        watchConfig.dropoutMs = ms;
+    } else if (strcmp(what, "hysteresis") == 0 && valid && !off) {
+        watchConfig.hysteresis = units;
+    } else {
+        console.println("Usage: watch [level <V> | spike <V> | dropout <V> [ms] | hysteresis <V> | level|spike|dropout off | off]");
+        return;
+    }
+    printWatchConfig();
+}
+
+// spectrum [<points> [<first frame>]] | spectrum window <W>: FFT of the recording
+static void cmdSpectrum(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "window") == 0) {
+        const char *name = argc > 2 ? argv[2] : "";
+        if (strcmp(name, "rect") == 0) {
+            spectrumWindow = WINDOW_RECT;
+        } else if (strcmp(name, "hann") == 0) {
+            spectrumWindow = WINDOW_HANN;
+        } else if (strcmp(name, "blackman") == 0) {
+            spectrumWindow = WINDOW_BLACKMAN;
+        } else if (strcmp(name, "flattop") == 0) {
+            spectrumWindow = WINDOW_FLATTOP;
+        } else {
+            console.println("Invalid window (rect, hann, blackman or flattop)");
+            return;
         }
-        else if (command.startsWith("help")) {
-            printHelp();
+        console.printf("Spectrum window: %s\n", windowName(spectrumWindow));
+        return;
+    }
+    if (recording && storageCompressed) {
+        console.println("Stop recording before analysing a compressed recording.");
+        return;
+    }
+    long frames = frameCount();
+    long points = SPECTRUM_MAX_POINTS;
+    while (points > frames && points > SPECTRUM_MIN_POINTS) points /= 2; // Largest FFT that fits
+    long first = -1;
+    if ((argc > 1 && (!parseInteger(argv[1], points) || points < SPECTRUM_MIN_POINTS || points > SPECTRUM_MAX_POINTS ||
+                      (points & (points - 1)) != 0)) ||
+        (argc > 2 && (!parseInteger(argv[2], first) || first < 0))) {
+        console.printf("Usage: spectrum [<points: power of two, %d-%d> [<first frame>]] | window <rect|hann|blackman|flattop>\n",
+                       SPECTRUM_MIN_POINTS, SPECTRUM_MAX_POINTS);
+        return;
+    }
+    if (first < 0) first = frames - points; // Default: the most recent frames
+    if (frames < points || first + points > frames) {
+        console.printf("Need %ld frames from frame %ld, but only %ld are recorded.\n", points, max(first, 0L), frames);
+        return;
+    }
+    SpectrumResult result;
+    for (int slot = 0; slot < channelCount; slot++) {
+        if (channelCount > 1) console.printf("--- GPIO%d ---\n", channelGpio(channelList[slot]));
+        int64_t start = esp_timer_get_time();
+        spectrumAnalyze(first, points, slot, spectrumWindow, result);
+        uint32_t elapsed = esp_timer_get_time() - start;
+        printSpectrum(result);
+        console.printf("Analysed in %.1f ms\n", elapsed / 1000.0);
+    }
+}
+
+static void cmdBench(int argc, char **argv) {
+    runBenchmarks();
+}
+
+static void cmdRead(int argc, char **argv) {
+    float voltage = currentVoltage();
+    console.printf("Current voltage: %.4f V\n", voltage);
+}
+
+static void cmdCalpoint(int argc, char **argv) {
+    const char *arg = argc > 1 ? argv[1] : "list";
+    float volts;
+    if (recording) {
+        console.println("Stop recording before calibrating.");
+    } else if (strcmp(arg, "clear") == 0) {
+        clearCalibrationPoints();
+        console.println("User calibration points cleared.");
+    } else if (strcmp(arg, "list") == 0) {
+        printCalibrationPoints();
+    } else if (parseNumber(arg, volts) && volts > 0 && volts <= 3.3) {
+        addCalibrationPoint(volts);
+    } else {
+        console.println("Usage: calpoint <known volts 0-3.3> | list | clear");
+    }
+}
+
+static void cmdCalibrate(int argc, char **argv) {
+    if (recording) {
+        console.println("Stop recording before calibrating.");
+        return;
+    }
+    calibrateADCOffset();
+}
+
+static void cmdHelp(int argc, char **argv) {
+    printHelp();
+}
+
+static const Command commands[] = {
+    { "start",     "begin",     cmdStart },
+    { "stop",      nullptr,     cmdStop },
+    { "show",      "print",     cmdShow },
+    { "dump",      nullptr,     cmdDump },
+    { "overview",  nullptr,     cmdOverview },
+    { "range",     nullptr,     cmdRange },
+    { "replay",    "replicate", cmdReplay },
+    { "arm",       nullptr,     cmdArm },
+    { "trigger",   nullptr,     cmdTrigger },
+    { "status",    nullptr,     cmdStatus },
+    { "timing",    nullptr,     cmdTiming },
+    { "spectrum",  "fft",       cmdSpectrum },
+    { "watch",     nullptr,     cmdWatch },
+    { "bench",     nullptr,     cmdBench },
+    { "clear",     nullptr,     cmdClear },
+    { "stream",    nullptr,     cmdStream },
+    { "net",       nullptr,     cmdNet },
+    { "baud",      nullptr,     cmdBaud },
+    { "rate",      nullptr,     cmdRate },
+    { "arena",     nullptr,     cmdArena },
+    { "samples",   nullptr,     cmdSamples },
+    { "mode",      nullptr,     cmdMode },
+    { "filter",    nullptr,     cmdFilter },
+    { "channels",  nullptr,     cmdChannels },
+    { "dac",       nullptr,     cmdDac },
+    { "interp",    nullptr,     cmdInterp },
+    { "dither",    nullptr,     cmdDither },
+    { "compress",  nullptr,     cmdCompress },
+    { "save",      nullptr,     cmdSave },
+    { "load",      nullptr,     cmdLoad },
+    { "ls",        "list",      cmdList },
+    { "rm",        nullptr,     cmdRemove },
+    { "record",    nullptr,     cmdRecord },
+    { "log",       nullptr,     cmdLog },
+    { "play",      nullptr,     cmdPlay },
+    { "sd",        nullptr,     cmdSd },
+    { "read",      nullptr,     cmdRead },
+    { "calpoint",  nullptr,     cmdCalpoint },
+    { "calibrate", nullptr,     cmdCalibrate },
+    { "help",      nullptr,     cmdHelp },
+};
+
+// Non-blocking: handles whatever complete lines have arrived since the last call
+void processSerialCommands() {
+    // The serial port and a network client share one command table
+    while (char *line = commandPoll()) {
+        if (!commandDispatch(commands, sizeof(commands) / sizeof(commands[0]), line)) {
+            console.println("Unknown command. Type 'help' for available commands.");
         }
-        else {
-            Serial.println("Unknown command. Type 'help' for available commands.");
+    }
+    while (char *line = netCommandPoll()) {
+        remoteCommand = true;
+        if (!commandDispatch(commands, sizeof(commands) / sizeof(commands[0]), line)) {
+            console.println("Unknown command. Type 'help' for available commands.");
         }
+        remoteCommand = false;
     }
 }
 
@@ -252,15 +982,221 @@ void processSerialCommands() {
 // =============================
 void startRecording() {
     if (recording) {
-        Serial.println("Already recording!");
+        console.println("Already recording!");
+        return;
+    }
+    if (replayActive()) {
+        console.println("Stop the replay before recording.");
+        return;
+    }
+    if (maxSamples == 0) {
+        console.println("No sample arena allocated! Use 'arena <KB>' to allocate one.");
+        return;
+    }
+    sampleCount = 0;           // Reset buffer
+    lastReportedCount = 0;
+    liveRing.clear();          // Drop live samples left over from the last recording
+    watchBegin(sampleRate);    // Fresh detector state and event counts
+    if (compressionEnabled) {
+        compressBegin();       // Samples are appended as delta/RLE tokens
+    } else {
+        storageCompressed = false;
+    }
+    recording = true;          // Set flag
+    recordingStartTime = millis(); // Store start time
+    samplerStart(sampleRate);  // Arm the sample timer (first sample is taken immediately)
+    if (channelCount > 1) {
+        console.printf("Started recording %d channels at %d Hz...\n", channelCount, sampleRate);
+    } else {
+        console.printf("Started recording at %d Hz...\n", sampleRate);
+    }
+    console.println("Type 'stop' to end recording.");
+}
+
+// =============================
+// Start Triggered Recording
+// =============================
+// Sample continuously into a circular buffer until the trigger fires, then
+// keep the pre-trigger window plus the post-trigger samples (see trigger.h).
+void startTriggeredRecording() {
+    if (recording) {
+        console.println("Already recording!");
+        return;
+    }
+    if (replayActive()) {
+        console.println("Stop the replay before recording.");
+        return;
+    }
+    if (channelCount > 1) {
+        console.println("Triggered capture records one channel. Use 'channels <gpio>' first.");
+        return;
+    }
+    if (triggerConfig.type == TRIG_OFF) {
+        console.println("No trigger set! Use 'trigger' to set one first.");
+        return;
+    }
+    uint32_t post = triggerPostSamples();
+    if (post == 0 || triggerConfig.pre + post > (uint32_t)maxSamples) {
+        console.printf("Trigger window (%u + %u samples) does not fit the %d sample arena.\n", (unsigned)triggerConfig.pre, (unsigned)post, maxSamples);
         return;
     }
     sampleCount = 0;           // Reset buffer
+    lastReportedCount = 0;
+    liveRing.clear();          // Drop live samples left over from the last recording
+    watchBegin(sampleRate);    // Fresh detector state and event counts
+    triggerArmed = true;
+    triggerReported = false;
+    storageCompressed = false; // The circular buffer needs random access, so triggered captures are never compressed
+    samplerSetTriggered(true);
     recording = true;          // Set flag
-    lastSampleTime = millis(); // Start timing
-    recordingStartTime = lastSampleTime; // Store start time
-    Serial.printf("Started recording at %d Hz...\n", sampleRate);
-    Serial.println("Type 'stop' to end recording.");
+    recordingStartTime = millis(); // Store start time
+    samplerStart(sampleRate);
+    console.printf("Armed at %d Hz. ", sampleRate);
+    printTriggerConfig();
+    console.println("Type 'stop' to disarm.");
+}
+
+// =============================
+// Start Recording to a File
+// =============================
+// Like streaming, but samples go to a recording file through the file sink,
+// so the capture length is bounded by the file system instead of RAM.
+void startFileRecording(fs::FS &fs, const char *path, const FileSinkConfig &config) {
+    if (recording) {
+        console.println("Already recording!");
+        return;
+    }
+    if (replayActive()) {
+        console.println("Stop the replay before recording.");
+        return;
+    }
+    if (channelCount > 1) {
+        console.println("Recording to a file takes one channel. Use 'channels <gpio>' first, or record to RAM and 'save'.");
+        return;
+    }
+    if (!fileSinkBegin(fs, path, config)) {
+        console.printf("ERROR: Could not create %s\n", path);
+        return;
+    }
+    lastReportedCount = 0;
+    liveRing.clear();          // Drop live samples left over from the last recording
+    watchBegin(sampleRate);    // Fresh detector state and event counts
+    samplerSetStoring(false);  // Samples only go to liveRing
+    recording = true;          // Set flag
+    recordingStartTime = millis(); // Store start time
+    samplerStart(sampleRate);
+    console.printf("Recording to %s at %d Hz. Type 'stop' to end.\n", path, sampleRate);
+}
+
+// =============================
+// Low-Power Logging
+// =============================
+// Blocks until a key is pressed: the chip light-sleeps between samples, so
+// the serial UI and acquisition task are idle for the whole session.
+void startLowPowerLog(fs::FS &fs, const char *path) {
+    if (remoteCommand) {
+        // Light sleep drops the Wi-Fi link and only a key on the USB serial port ends it
+        console.println("Low-power logging can only be started from the USB serial port.");
+        return;
+    }
+    if (recording || replayActive()) {
+        console.println("Stop recording/replay before logging.");
+        return;
+    }
+    if (channelCount > 1) {
+        console.println("Low-power logging takes one channel. Use 'channels <gpio>' first.");
+        return;
+    }
+    if (sampleRate > LOWPOWER_MAX_RATE) {
+        console.printf("Low-power logging is for slow rates (1-%d Hz). Use 'record' above that.\n", LOWPOWER_MAX_RATE);
+        return;
+    }
+    if (autoOversampling) adcSamples = autoSamplesFor(sampleRate);
+    console.printf("Low-power logging to %s at %d Hz (%d ADC samples, light sleep between samples, %d samples per flash write).\n",
+                  path, sampleRate, adcSamples, LOWPOWER_BATCH);
+    if (netAvailable()) {
+        console.println("Wi-Fi is switched off while logging (light sleep would drop it) and rejoins afterwards.");
+        Serial.flush();
+        netSuspend();
+    }
+    console.println("Press any key to stop.");
+    digitalWrite(LED_PIN, LOW); // The LED would cost more than the logging itself
+    bool started = lowPowerLog(fs, path, sampleRate);
+    digitalWrite(LED_PIN, HIGH);
+    if (netAvailable()) netBegin();
+    if (!started) {
+        console.printf("ERROR: Could not create %s\n", path);
+        return;
+    }
+    const LowPowerStats &stats = lowPowerStats();
+    console.printf("Logging stopped. %u samples in %u flash writes over %.1f s.\n", (unsigned)stats.samples, (unsigned)stats.batches,
+                  stats.totalMicros / 1000000.0);
+    console.printf("Awake %.2f%% of the time, %u samples late.\n", stats.totalMicros > 0 ? 100.0 * stats.awakeMicros / stats.totalMicros : 0.0,
+                  (unsigned)stats.late);
+    if (stats.writeFailed) console.println("WARNING: Storage full, logging stopped early.");
+}
+
+// =============================
+// Start Streaming
+// =============================
+// Like recording, but samples are sent to the host as binary frames instead of
+// being kept in memory, so the capture length is unbounded.
+void startStreaming() {
+    if (recording) {
+        console.println("Already recording!");
+        return;
+    }
+    if (replayActive()) {
+        console.println("Stop the replay before streaming.");
+        return;
+    }
+    if (channelCount > 1) {
+        console.println("Streaming sends one channel. Use 'channels <gpio>' first.");
+        return;
+    }
+    console.printf("Streaming at %d Hz (binary frames). Type 'stop' to end.\n", sampleRate);
+    Serial.flush();
+    lastReportedCount = 0;
+    liveRing.clear();          // Drop live samples left over from the last recording
+    watchBegin(sampleRate);    // Fresh detector state and event counts
+    samplerSetStoring(false);  // Samples only go to liveRing
+    streamBegin();
+    recording = true;          // Set flag
+    recordingStartTime = millis(); // Store start time
+    samplerStart(sampleRate);
+}
+
+// =============================
+// Start Network Streaming
+// =============================
+// Like 'stream', but the frames go to a collector as UDP datagrams, sent by
+// the network task, so many recorders can stream to one host at once.
+void startNetStreaming(const char *host, uint16_t port) {
+    if (recording) {
+        console.println("Already recording!");
+        return;
+    }
+    if (replayActive()) {
+        console.println("Stop the replay before streaming.");
+        return;
+    }
+    if (channelCount > 1) {
+        console.println("Streaming sends one channel. Use 'channels <gpio>' first.");
+        return;
+    }
+    lastReportedCount = 0;
+    liveRing.clear();          // Drop live samples left over from the last recording
+    watchBegin(sampleRate);    // Fresh detector state and event counts
+    if (!netStreamBegin(host, port)) {
+        console.println(netAvailable() ? "ERROR: Not connected to Wi-Fi, or not an IP address." : "Network support is not built in.");
+        return;
+    }
+    samplerSetStoring(false);  // Samples only go to liveRing
+    recording = true;          // Set flag
+    recordingStartTime = millis(); // Store start time
+    samplerStart(sampleRate);
+    console.printf("Streaming at %d Hz to %s:%u over UDP (%d samples per packet). Type 'stop' to end.\n", sampleRate, host, (unsigned)port,
+                   NET_PACKET_SAMPLES);
 }
 
 // =============================
@@ -268,30 +1204,103 @@ void startRecording() {
 // =============================
 void stopRecording() {
     if (!recording) {
-        Serial.println("Not currently recording.");
+        console.println("Not currently recording.");
         return;
     }
+    samplerStop();             // Disarm the sample timer
     recording = false;         // Clear flag
     digitalWrite(LED_PIN, HIGH); // Turn LED on
     recordingEndTime = millis(); // Store end time
-    Serial.printf("Recording stopped. Captured %d samples.\n", sampleCount);
-    Serial.printf("Duration: %.2f s\n", (recordingEndTime - recordingStartTime) / 1000.0);
-    Serial.printf("Expected: %.2f s\n", (float)sampleCount / sampleRate);
-    bool timingIssue = fabs(((recordingEndTime - recordingStartTime) / 1000.0) - ((float)sampleCount / sampleRate)) > 0.2 * ((float)sampleCount / sampleRate);
+    if (streamActive()) {
+        streamService(); // Events in the last samples go out before the end frame
+        watchService();
+        streamEnd();
+        samplerSetStoring(true);
+        console.printf("\nStreaming stopped. Sent %u samples", (unsigned)streamSent());
+        console.printf(" (%u dropped by the serial link).\n", (unsigned)streamDropped());
+        if (streamDropped() > 0) {
+            console.println("WARNING: The serial link could not keep up. Lower 'rate' or use a higher baud rate.");
+        }
+        return;
+    }
+    if (netStreamActive()) {
+        netStreamEnd();
+        samplerSetStoring(true);
+        console.printf("Network streaming stopped. Sent %u samples in %u packets (%u dropped).\n", (unsigned)netStreamSent(),
+                       (unsigned)netStreamPackets(), (unsigned)netStreamDropped());
+        return;
+    }
+    if (fileSinkActive()) {
+        fileSinkEnd();
+        samplerSetStoring(true);
+        console.printf("Recording stopped. Wrote %u samples in %u blocks", (unsigned)fileSinkWritten(), (unsigned)fileSinkBlocks());
+        console.printf(" (%u samples dropped, %u whole blocks).\n", (unsigned)fileSinkDropped(), (unsigned)fileSinkDroppedBlocks());
+        console.printf("File flushes: %u, slowest block write: %.1f ms\n", (unsigned)fileSinkSyncs(), fileSinkMaxWriteMicros() / 1000.0);
+        if (fileSinkFailed()) {
+            console.println("WARNING: The file system filled up; the recording ends early.");
+        } else if (fileSinkDropped() > 0) {
+            console.println("WARNING: File writes could not keep up. Lower 'rate' or flush less often ('sd sync').");
+        }
+        if (samplerMissedTicks() > 0) {
+            console.printf("WARNING: %u sample periods missed during file writes.\n", (unsigned)samplerMissedTicks());
+        }
+        return;
+    }
+    if (triggerArmed) {
+        triggerArmed = false;
+        samplerSetTriggered(false);
+        if (samplerFinishCapture() == 0) {
+            console.println("Disarmed. The trigger never fired; nothing was kept.");
+            return;
+        }
+        console.printf("Captured %d samples around the trigger (trigger at sample %u, %.2f s after arming).\n",
+                      sampleCount, (unsigned)triggerConfig.pre, (float)samplerTriggerIndex() / sampleRate);
+        console.println("Type 'show' to view data or 'replay' to replicate voltages.");
+        return;
+    }
+    if (storageCompressed) {
+        compressFlush();       // The acquisition task is idle now
+    }
+    int frames = frameCount();
+    if (channelCount > 1) {
+        console.printf("Recording stopped. Captured %d frames of %d channels (%d samples).\n", frames, channelCount, sampleCount);
+    } else {
+        console.printf("Recording stopped. Captured %d samples.\n", sampleCount);
+    }
+    if (storageCompressed) {
+        console.printf("Compressed to %.1f KB (%.2fx)\n", compressedBytes() / 1024.0, compressionRatio());
+    }
+    console.printf("Duration: %.2f s\n", (recordingEndTime - recordingStartTime) / 1000.0);
+    console.printf("Expected: %.2f s\n", (float)frames / sampleRate);
+    bool timingIssue = fabs(((recordingEndTime - recordingStartTime) / 1000.0) - ((float)frames / sampleRate)) > 0.2 * ((float)frames / sampleRate);
     if (timingIssue) {
-        String warn = "WARNING: Actual duration deviates from expected. Possible causes:";
-        if (sampleRate > BASELINE_SAMPLE_RATE && adcSamples > BASELINE_ADC_SAMPLES) {
-            warn += " High sample rate and high ADC samples (oversampling) may be slowing down recording.";
+        console.print("WARNING: Actual duration deviates from expected. Possible causes:");
+        if (autoOversampling) {
+            console.println(" Even 1 ADC sample per reading is too slow for this rate and channel count.");
+        } else if (sampleRate > BASELINE_SAMPLE_RATE && adcSamples > BASELINE_ADC_SAMPLES) {
+            console.println(" High sample rate and high ADC samples (oversampling) may be slowing down recording.");
         } else if (sampleRate > BASELINE_SAMPLE_RATE) {
-            warn += " High sample rate may be slowing down recording.";
+            console.println(" High sample rate may be slowing down recording.");
         } else if (adcSamples > BASELINE_ADC_SAMPLES) {
-            warn += " High ADC samples (oversampling) may be slowing down recording.";
+            console.println(" High ADC samples (oversampling) may be slowing down recording.");
         } else {
-            warn += " System or code delays.";
+            console.println(" System or code delays.");
         }
-        Serial.println(warn);
     }
-    Serial.println("Type 'show' to view data or 'replay' to replicate voltages.");
+    if (samplerMissedTicks() > 0) {
+        console.printf("WARNING: %u sample periods missed (each reading takes longer than 1/%d s). Lower 'samples' or 'rate'.\n", (unsigned)samplerMissedTicks(), sampleRate);
+    }
+    if (autoOversampling && autoOversampleReductions() > 0) {
+        console.printf("Auto oversampling: deadlines slipped, reduced %u times from %d to %d ADC samples per reading.\n",
+                      (unsigned)autoOversampleReductions(), autoOversampleStartSamples(), adcSamples);
+    }
+    TimingStats timing;
+    timingGet(timing);
+    if (timing.workCount > 0) {
+        console.printf("Timing: worst late %+ld us, %u missed deadlines, max interval %u us. Type 'timing' for the histogram.\n",
+                      (long)timing.worstLate, (unsigned)timing.deadlineMisses, (unsigned)(timing.count > 0 ? timing.maxInterval : 0));
+    }
+    console.println("Type 'show' to view data or 'replay' to replicate voltages.");
 }
 
 // =============================
@@ -299,80 +1308,104 @@ void stopRecording() {
 // =============================
 void printData() {
     if (sampleCount == 0) {
-        Serial.println("No data recorded!");
-        return;
-    }
-    Serial.printf("Printing %d recorded samples:\n", sampleCount);
-    Serial.println("Sample#,Voltage(V),Time(ms)");
-    Serial.println("------------------------");
-    for (int i = 0; i < sampleCount; i++) {
-        float timeMs = (float)i * 1000.0 / sampleRate;
-        Serial.printf("%d,%.4f,%.1f\n", i, voltageBuffer[i], timeMs);
-        // Pause every 20 lines to prevent overwhelming the serial output
-        if ((i + 1) % 20 == 0 && i < sampleCount - 1) {
-            Serial.println("--- Press any key to continue ---");
+        console.println("No data recorded!");
+        return;
+    }
+    if (recording && storageCompressed) {
+        console.println("Stop recording before viewing a compressed recording.");
+        return;
+    }
+    SampleReader reader;
+    reader.begin();
+    int frames = frameCount();
+    console.printf("Printing %d recorded samples:\n", frames);
+    if (channelCount > 1) {
+        // One column per channel
+        console.print("Sample#");
+        for (int c = 0; c < channelCount; c++) console.printf(",GPIO%d(V)", channelGpio(channelList[c]));
+        console.println(",Time(ms)");
+    } else {
+        console.println("Sample#,Voltage(V),Time(ms)");
+    }
+    console.println("------------------------");
+    for (int i = 0; i < frames; i++) {
+        float timeMs = sampleTimeMs(i); // Measured, from the acquisition task's timestamps
+        console.printf("%d,", i);
+        for (int c = 0; c < channelCount; c++) console.printf("%.4f,", sampleToVolts(reader.next()));
+        console.printf("%.1f\n", timeMs);
+        // Pause every 20 lines to prevent overwhelming the serial output. The key
+        // is read from Serial, so a network client gets the whole table unpaged.
+        if (!remoteCommand && (i + 1) % 20 == 0 && i < frames - 1) {
+            console.println("--- Press any key to continue ---");
             while (!Serial.available()) delay(10);
             while (Serial.available()) Serial.read(); // Clear buffer
         }
     }
-    Serial.println("------------------------");
-    Serial.printf("Total: %d samples\n", sampleCount);
+    console.println("------------------------");
+    console.printf("Total: %d samples\n", frames);
 }
 
 // =============================
 // Replay Recorded Voltages on DAC
 // =============================
-void replayVoltages() {
+void replayVoltages(uint32_t passes) {
     if (sampleCount == 0) {
-        Serial.println("No data to replay!");
-        return;
-    }
-    Serial.printf("Replaying %d voltage samples...\n", sampleCount);
-    Serial.println("Note: ESP32 DAC has limited precision (8-bit, 0-3.3V range)");
-    Serial.println("Type any key to stop replay.\n");
-    unsigned long replayStart = millis(); // Start timing
-    unsigned long sampleInterval_us = 1000000UL / sampleRate;
-    unsigned long nextSampleTime = micros();
-    float lastPrintedVoltage = -1.0; // Track last printed voltage for change detection
-    for (int i = 0; i < sampleCount && !Serial.available(); i++) {
-        float voltage = voltageBuffer[i];
-        // Convert voltage to DAC value (0-255 for 0-3.3V)
-        // Clamp to 3.3V max
-        if (voltage > 3.3) voltage = 3.3;
-        if (voltage < 0) voltage = 0;
-        uint8_t dacValue = (uint8_t)(voltage * 255.0 / 3.3);
-        dac_output_voltage(DAC_CHANNEL_1, dacValue); // Output voltage on DAC
-        // Print every 50th sample OR when voltage changes significantly (>0.1V)
-        if (i % 50 == 0 || fabs(voltage - lastPrintedVoltage) > 0.1) {
-            Serial.printf("Sample %d: %.4fV -> DAC %d\n", i, voltage, dacValue);
-            lastPrintedVoltage = voltage;
-        }
-        // Precise timing using micros()
-        nextSampleTime += sampleInterval_us;
-        long wait = nextSampleTime - micros();
-        if (wait > 0) {
-            delayMicroseconds(wait);
-        }
+        console.println("No data to replay!");
+        return;
     }
-    unsigned long replayEnd = millis();
-    // Clear any pending serial input
-    while (Serial.available()) Serial.read();
-    // Reset DAC to 0V
-    dac_output_voltage(DAC_CHANNEL_1, 0);
-    Serial.println("Replay completed.");
-    float replaySec = (replayEnd - replayStart) / 1000.0;
-    float expectedSec = (float)sampleCount / sampleRate;
-    Serial.printf("Duration: %.2f s\n", replaySec);
-    Serial.printf("Expected: %.2f s\n", expectedSec);
+    if (recording) {
+        console.println("Stop recording before replaying.");
+        return;
+    }
+    if (replayActive()) {
+        console.println("Already replaying! Type 'stop' first.");
+        return;
+    }
+    if (!replayStart(passes)) {
+        console.println("ERROR: Could not start the DAC replay engine!");
+        return;
+    }
+    if (passes == REPLAY_LOOP_FOREVER) {
+        console.printf("Replaying %d voltage samples in a loop...\n", frameCount());
+    } else {
+        console.printf("Replaying %d voltage samples x%u...\n", frameCount(), (unsigned)passes);
+    }
+    if (replaySpeed() != REPLAY_SPEED_ONE) {
+        console.printf("Recorded at %d Hz, playing at %.2fx (%.1f samples/s)\n", recordedRate, (float)replaySpeed() / REPLAY_SPEED_ONE,
+                      (float)recordedRate * replaySpeed() / REPLAY_SPEED_ONE);
+    } else if (recordedRate != sampleRate) {
+        console.printf("Recorded at %d Hz, playing at that rate\n", recordedRate);
+    }
+    if (replayOutputSlot(1) >= 0) {
+        console.printf("Channel %d on DAC1 (GPIO%d), channel %d on DAC2 (GPIO%d)\n", replayOutputSlot(0) + 1, DAC_PIN, replayOutputSlot(1) + 1, DAC2_PIN);
+    }
+    console.printf("DAC clock: %u Hz (%u updates per sample, DMA-paced, %s interpolation, dither %s)\n", (unsigned)replayOutputRate(),
+                  (unsigned)replayRepeat(), interpName(interpMode), ditherName(ditherMode));
+    if (ditherMode == DITHER_OFF) {
+        console.println("Note: ESP32 DAC has limited precision (8-bit, 0-3.3V range). 'dither tpdf' trades it for noise.");
+    } else {
+        console.println("Note: ESP32 DAC is 8-bit; dither averages to finer levels (filter the output with an RC low-pass).");
+    }
+    console.println("Replay runs in the background. Type 'stop' to end it.\n");
+    replayReported = false;
+}
+
+// Print the summary once a background replay has finished (called from loop())
+void reportReplayFinished() {
+    if (replayReported || replayActive() || replayOutputRate() == 0) return;
+    replayReported = true;
+    if (replayReadFailed()) {
+        console.println("ERROR: No readable samples in the file (missing or corrupt chunks). Replay stopped.");
+        return;
+    }
+    console.println("Replay completed.");
+    float replaySec = replayDurationMicros() / 1000000.0;
+    float expectedSec = (float)replayPosition() * REPLAY_SPEED_ONE / ((float)replaySampleRate() * replaySpeed());
+    console.printf("Duration: %.2f s\n", replaySec);
+    console.printf("Expected: %.2f s\n", expectedSec);
     bool timingIssue = fabs(replaySec - expectedSec) > 0.2 * expectedSec;
     if (timingIssue) {
-        String warn = "WARNING: Replay duration does not match expected duration. Possible causes:";
-        if (sampleRate > BASELINE_SAMPLE_RATE) {
-            warn += " High sample rate may be causing timing issues during replay.";
-        } else {
-            warn += " System or code delays.";
-        }
-        Serial.println(warn);
+        console.println("WARNING: Replay duration does not match expected duration. Possible causes: System or code delays.");
     }
 }
 
@@ -380,50 +1413,170 @@ void replayVoltages() {
 // Print System Status
 // =============================
 void printStatus() {
-    Serial.println("=== System Status ===");
-    Serial.printf("Recording: %s\n", recording ? "YES" : "NO");
-    Serial.printf("Samples in buffer: %d/%d\n", sampleCount, MAX_SAMPLES);
-    Serial.printf("Sample rate: %d Hz\n", sampleRate);
+    console.println("=== System Status ===");
+    console.printf("Build: %s, up to %d channel(s)\n", BUILD_PROFILE, MAX_CHANNELS);
+    console.printf("Recording: %s\n", recording ? "YES" : "NO");
+    if (replayActive()) {
+        uint32_t length = replayLength();
+        uint32_t count = length > 0 ? length : 0xFFFFFFFF; // Unknown length: show the raw position
+        if (replayPasses() == REPLAY_LOOP_FOREVER) {
+            console.printf("Replay: pass %u (looping), sample %u/%u\n", (unsigned)replayPass() + 1, (unsigned)(replayPosition() % count), (unsigned)length);
+        } else {
+            console.printf("Replay: pass %u/%u, sample %u/%u\n", (unsigned)replayPass() + 1, (unsigned)replayPasses(), (unsigned)(replayPosition() % count), (unsigned)length);
+        }
+    } else {
+        console.println("Replay: NO");
+    }
+    if (storageCompressed) {
+        console.printf("Samples in buffer: %d (compressed, %d uncompressed capacity)\n", sampleCount, maxSamples);
+    } else {
+        console.printf("Samples in buffer: %d/%d\n", sampleCount, maxSamples);
+    }
+    console.printf("Sample rate: %d Hz\n", sampleRate);
+    if (sampleCount > 0 && recordedRate != sampleRate) {
+        console.printf("Buffer recorded at: %d Hz\n", recordedRate);
+    }
+    if (replaySpeed() != REPLAY_SPEED_ONE) {
+        console.printf("Replay speed: %.2fx\n", (float)replaySpeed() / REPLAY_SPEED_ONE);
+    }
+    console.printf("Channels: %d (", channelCount);
+    printChannels();
+    console.println(channelCount > 1 ? ", interleaved; stats follow the first)" : ")");
+    if (netStreamActive()) {
+        console.printf("Streaming over UDP: %u samples in %u packets, %u dropped\n", (unsigned)netStreamSent(), (unsigned)netStreamPackets(),
+                       (unsigned)netStreamDropped());
+    }
+    if (fileSinkActive()) {
+        console.printf("Recording to file: %u samples in %u blocks, %u dropped (%u blocks), slowest write %.1f ms\n",
+                      (unsigned)fileSinkWritten(), (unsigned)fileSinkBlocks(), (unsigned)fileSinkDropped(),
+                      (unsigned)fileSinkDroppedBlocks(), fileSinkMaxWriteMicros() / 1000.0);
+    }
+    if (triggerArmed) console.print(samplerTriggered() ? "Triggered, capturing. " : "Armed, waiting. ");
+    printTriggerConfig();
+    printWatchConfig();
+    console.printf("Serial baud rate: %u\n", (unsigned)serialBaud);
+    if (acqMode == ACQ_FAST) {
+        console.printf("Acquisition mode: fast (I2S DMA, %s filter)\n", filterName(filterType));
+        if (recording) {
+            console.printf("ADC stream: %u Hz, %u samples per output\n", (unsigned)samplerStreamRate(), (unsigned)samplerDecimation());
+        }
+    } else {
+        console.println("Acquisition mode: precise");
+    }
+    if (autoOversampling) {
+        console.printf("ADC samples per reading: %d (auto, %.2f us per conversion)\n", adcSamples, adcReadMicros());
+    } else {
+        console.printf("ADC samples per reading: %d\n", adcSamples);
+    }
     if (sampleRate > BASELINE_SAMPLE_RATE) {
-        Serial.println("NOTICE: Sample rate is above baseline value. Recording and replay timing may be inaccurate!");
-    }
-    Serial.printf("Memory usage: %.1f KB\n", (float)(sampleCount * sizeof(float)) / 1024.0);
-    float currentVoltage = readVoltageHighPrecision();
-    Serial.printf("Current voltage: %.4f V\n", currentVoltage);
-    if (sampleCount > 0) {
-        float minV = voltageBuffer[0], maxV = voltageBuffer[0];
-        float avgV = 0;
-        for (int i = 0; i < sampleCount; i++) {
-            if (voltageBuffer[i] < minV) minV = voltageBuffer[i];
-            if (voltageBuffer[i] > maxV) maxV = voltageBuffer[i];
-            avgV += voltageBuffer[i];
+        console.println("NOTICE: Sample rate is above baseline value. Recording and replay timing may be inaccurate!");
+    }
+    console.printf("Memory usage: %.1f KB of %.1f KB (%s)\n", compressedBytes() / 1024.0, sampleArenaBytes() / 1024.0, sampleArenaInPsram() ? "PSRAM" : "DRAM");
+    if (storageCompressed) {
+        console.printf("Compression: %.2fx (%.1f KB of samples in %.1f KB)\n", compressionRatio(), (float)(sampleCount * sizeof(sample_t)) / 1024.0, compressedBytes() / 1024.0);
+    } else {
+        console.printf("Compression: %s\n", compressionEnabled ? "on (next recording)" : "off");
+    }
+    console.printf("Current voltage: %.4f V\n", currentVoltage());
+    // Statistics are maintained by the acquisition task, so this is O(1)
+    RunningStats stats;
+    samplerGetStats(stats);
+    if (stats.count > 0) {
+        console.printf("Recorded range: %.4f - %.4f V (avg: %.4f V, std dev: %.4f V)\n", sampleToVolts(stats.minSample), sampleToVolts(stats.maxSample), stats.meanVolts(), stats.stdDevVolts());
+        console.printf("Actual recording duration: %.2f seconds\n", (recordingEndTime > recordingStartTime) ? ((recordingEndTime - recordingStartTime) / 1000.0) : 0.0);
+    }
+}
+
+// =============================
+// Baud Rate Negotiation
+// =============================
+// Announce the new rate, switch, then wait for the host to send "ok" at the
+// new rate. If nothing arrives within BAUD_CONFIRM_MS (host didn't follow, or
+// the link can't run that fast) fall back to the previous rate.
+bool negotiateBaudRate(uint32_t newBaud) {
+    uint32_t oldBaud = serialBaud;
+    console.printf("BAUD %u SWITCHING (send 'ok' at the new rate within %d ms)\n", (unsigned)newBaud, BAUD_CONFIRM_MS);
+    Serial.flush();              // Let the announcement leave at the old rate
+    Serial.updateBaudRate(newBaud);
+    while (Serial.available()) Serial.read(); // Discard bytes garbled by the switch
+    char reply[8];
+    size_t length = 0;
+    unsigned long deadline = millis() + BAUD_CONFIRM_MS;
+    while ((long)(deadline - millis()) > 0) {
+        if (!Serial.available()) {
+            delay(1);
+            continue;
+        }
+        char c = Serial.read();
+        if (c == '\n' || c == '\r') {
+            reply[length] = '\0';
+            if (strcasecmp(reply, "ok") == 0) {
+                serialBaud = newBaud;
+                console.printf("BAUD %u OK\n", (unsigned)newBaud);
+                return true;
+            }
+            length = 0;
+        } else if (length < sizeof(reply) - 1) {
+            reply[length++] = c;
         }
-        avgV /= sampleCount;
-        Serial.printf("Recorded range: %.4f - %.4f V (avg: %.4f V)\n", minV, maxV, avgV);
-        Serial.printf("Actual recording duration: %.2f seconds\n", (recordingEndTime > recordingStartTime) ? ((recordingEndTime - recordingStartTime) / 1000.0) : 0.0);
     }
+    Serial.updateBaudRate(oldBaud);
+    while (Serial.available()) Serial.read();
+    console.printf("BAUD %u FAILED (no confirmation), staying at %u\n", (unsigned)newBaud, (unsigned)oldBaud);
+    return false;
 }
 
 // =============================
 // Print Help / Commands
 // =============================
 void printHelp() {
-    Serial.println("\n=== Available Commands ===");
-    Serial.println("start/begin   - Start voltage recording");
-    Serial.println("stop          - Stop recording");
-    Serial.println("show/print    - Display recorded data");
-    Serial.println("replay        - Replicate recorded voltages on DAC pin");
-    Serial.println("status        - Show system status");
-    Serial.println("read          - Read current voltage");
-    Serial.println("clear         - Clear sample buffer");
-    Serial.println("calibrate     - Calibrate ADC offset (run with pin grounded)");
-    Serial.println("rate <Hz>     - Set sample rate (1-10000 Hz)");
-    Serial.println("samples <N>   - Set ADC samples per reading (1-1024)");
-    Serial.println("help          - Show this help");
-    Serial.println("\nConnections:");
-    Serial.printf("Voltage input: GPIO%d (0-3.3V max!)\n", ADC_PIN);
-    Serial.printf("Voltage output: GPIO%d (DAC)\n", DAC_PIN);
-    Serial.printf("\nMax samples: %d (%.1f KB memory)\n", MAX_SAMPLES, (float)(MAX_SAMPLES * sizeof(float)) / 1024.0);
+    console.println("\n=== Available Commands ===");
+    console.println("start/begin   - Start voltage recording");
+    console.println("stop          - Stop recording");
+    console.println("arm           - Wait for the trigger, keep the samples around it");
+    console.println("trigger ...   - above|below|rising|falling <V>, window <lo> <hi>, pre/post <N>, off");
+    console.println("stream        - Stream samples to the host as binary frames (unbounded)");
+    console.println("net [stream <ip> [port]] - Wi-Fi status, or stream samples to a collector over UDP");
+    console.println("show/print    - Display recorded data");
+    console.println("dump          - Export recorded data as one binary blob (for tools/)");
+    console.println("overview <N>  - Min/max envelope of the recording in N points (binary, works while recording)");
+    console.println("range <a> <b> - Export frames a to b-1 like dump (zoom in after an overview)");
+    console.println("replay [loop|N] - Replay on DAC pin in the background (once, forever, or N times)");
+    console.println("replay speed <x> - Playback speed for replay and play (0.1-10, default 1)");
+    console.println("status        - Show system status");
+    console.println("timing        - Sample jitter histogram, worst late sample, missed deadlines");
+    console.println("spectrum [N [first]] - FFT of the recording: tones, THD and noise floor (window <W> to change window)");
+    console.println("watch ...     - Report level crossings, spikes and dropouts live: level|spike|dropout <V>, hysteresis <V>, off");
+    console.println("bench         - Run benchmarks (machine-readable BENCH lines, see tools/bench.py)");
+    console.println("read          - Read current voltage");
+    console.println("clear         - Clear sample buffer");
+    console.println("calibrate     - Calibrate ADC offset (run with pin grounded)");
+    console.println("calpoint <V>  - Add a calibration point with a known voltage applied (list/clear)");
+    console.println("rate <Hz>     - Set sample rate (1-10000 Hz)");
+    console.println("baud <rate>   - Switch serial speed (host must confirm with 'ok')");
+    console.println("samples <N>   - Set ADC samples per reading (1-1024)");
+    console.println("samples auto  - Pick the most ADC samples each sample period allows (lowered live if deadlines slip)");
+    console.println("mode <M>      - Acquisition mode: precise (default) or fast (DMA)");
+    console.println("filter <F>    - Fast mode decimation filter: box, cic (default) or fir");
+    console.println("arena <KB>    - Resize sample memory (0 = all available, clears buffer)");
+    console.println("channels <pins> - Record several ADC1 inputs at once (GPIO32-39)");
+    console.println("dac <ch> [<ch>|off] - Recorded channels replayed on DAC1 and DAC2");
+    console.println("interp <I>    - Replay between samples: hold (default), linear or fir");
+    console.println("dither <D>    - Replay dither before the 8-bit DAC: off (default), tpdf or shaped");
+    console.println("compress on|off - Lossless delta/RLE compressed recording (longer captures)");
+    console.println("save <name>   - Save the recording to flash");
+    console.println("load <name>   - Load a recording from flash");
+    console.println("ls / rm <name> - List or remove recordings on flash");
+    console.println("record <name> - Record straight to flash (length limited by flash, not RAM)");
+    console.println("log <name>    - Low-power logging to flash at 1-20 Hz (light sleep between samples, any key stops)");
+    console.println("play <name> [loop|N] - Replay a recording straight from flash");
+    console.println("sd [ls|record <name>|play <name>|log <name>|sync <N>] - SD card info, recordings and flush policy");
+    console.println("help          - Show this help");
+    console.println("\nConnections:");
+    console.printf("Voltage input: GPIO%d (0-3.3V max!)\n", ADC_PIN);
+    console.printf("Voltage output: GPIO%d (DAC)\n", DAC_PIN);
+    console.println();
+    printArenaInfo();
 }
 // =============================
 // END OF FILE
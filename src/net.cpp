@@ -0,0 +1,282 @@
+// =============================
+// Network Transport (Wi-Fi)
+// =============================
+
+#include "net.h"
+#include "console.h"
+
+#ifdef WIFI_SSID
+
+#include "frame.h"
+#include "recorder.h"
+#include "sampler.h"
+#include "command.h"
+#include "watch.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD ""
+#endif
+
+#define NET_PAYLOAD_BYTES (12 + 2 * NET_PACKET_SAMPLES)
+
+static WiFiServer server(NET_COMMAND_PORT);
+static WiFiClient client;                   // Remote command client (one at a time)
+static bool clientConnected = false;
+static CommandLine clientLine;
+static bool linkUp = false;                 // Wi-Fi connected as of the last poll
+static bool serverStarted = false;
+
+static WiFiUDP udp;
+static IPAddress collector;
+static uint16_t collectorPort = NET_STREAM_PORT;
+static TaskHandle_t netHandle = nullptr;    // Network task
+static volatile bool active = false;        // Stream running (until its end frame is out)
+static volatile bool stopRequested = false; // Set by netStreamEnd()
+static volatile uint32_t sentCount = 0;
+static volatile uint32_t droppedCount = 0;
+static volatile uint32_t packetCount = 0;
+static uint32_t streamRate = 0;             // Sample rate announced in the start frame
+static uint16_t frameSeq = 0;
+static uint32_t expectedIndex = 0;
+static uint16_t pending = 0;                // Samples in the packet being assembled
+static unsigned long pendingSince = 0;
+static uint8_t payload[NET_PAYLOAD_BYTES];
+static uint8_t packet[FRAME_BYTES(NET_PAYLOAD_BYTES)];
+
+// One frame per datagram
+static bool sendPacket(uint8_t type, const uint8_t *data, uint16_t length) {
+    size_t bytes = encodeFrame(packet, type, data, length);
+    return udp.beginPacket(collector, collectorPort) && udp.write(packet, bytes) == bytes && udp.endPacket();
+}
+
+static void sendStart() {
+    uint8_t start[10];
+    uint8_t *p = start;
+    p = putU8(p, FRAME_FORMAT_VERSION);
+    p = putU16(p, SAMPLE_UNITS_PER_VOLT);
+    p = putU32(p, streamRate);
+    p = putU16(p, adcSamples);
+    putU8(p, acqMode);
+    sendPacket(FRAME_STREAM_START, start, sizeof(start));
+}
+
+// Same data frame layout as the serial stream (stream.cpp)
+static void flushPacket() {
+    if (pending == 0) return;
+    uint8_t *p = putU16(payload, frameSeq++);
+    p += 8; // first_index / first_time_us were written when the packet was started
+    putU16(p, pending);
+    if (sendPacket(FRAME_STREAM_DATA, payload, 12 + 2 * pending)) {
+        sentCount = sentCount + pending;
+        packetCount = packetCount + 1;
+    } else {
+        droppedCount = droppedCount + pending; // The stack is out of buffers; the sequence gap shows it
+    }
+    pending = 0;
+}
+
+static void drain() {
+    LiveSample live;
+    while (liveRing.pop(live)) {
+        if (live.index != expectedIndex) {
+            droppedCount = droppedCount + (live.index - expectedIndex);
+            flushPacket();
+        }
+        expectedIndex = live.index + 1;
+        watchSample(live);
+        if (pending == 0) {
+            uint8_t *p = putU32(payload + 2, live.index);
+            putU32(p, live.micros);
+            pendingSince = millis();
+        }
+        putU16(payload + 12 + 2 * pending, live.sample);
+        if (++pending == NET_PACKET_SAMPLES) flushPacket();
+    }
+    if (pending > 0 && millis() - pendingSince >= NET_FLUSH_MS) flushPacket();
+}
+
+static void netTask(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // netStreamBegin()
+        sendStart();
+        unsigned long lastStart = millis();
+        while (!stopRequested) {
+            drain();
+            if (millis() - lastStart >= NET_START_REPEAT_MS) {
+                sendStart();
+                lastStart = millis();
+            }
+            vTaskDelay(pdMS_TO_TICKS(2));
+        }
+        drain(); // The sampler is stopped: pick up the last samples
+        flushPacket();
+        uint8_t end[8];
+        uint8_t *p = putU32(end, sentCount);
+        putU32(p, droppedCount);
+        sendPacket(FRAME_STREAM_END, end, sizeof(end));
+        active = false;
+    }
+}
+
+void netBegin() {
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(false); // Modem sleep adds latency and costs throughput
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    console.printf("Network: joining %s (commands on TCP port %d once connected)\n", WIFI_SSID, NET_COMMAND_PORT);
+}
+
+bool netAvailable() {
+    return true;
+}
+
+void netSuspend() {
+    if (clientConnected) {
+        console.setMirror(nullptr);
+        client.stop();
+        clientConnected = false;
+    }
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    linkUp = false;
+}
+
+char *netCommandPoll() {
+    bool up = WiFi.status() == WL_CONNECTED;
+    if (up != linkUp) {
+        linkUp = up;
+        if (up) {
+            if (!serverStarted) {
+                server.begin();
+                server.setNoDelay(true);
+                serverStarted = true;
+            }
+            console.printf("Network: connected as %s\n", WiFi.localIP().toString().c_str());
+        } else {
+            console.println("Network: Wi-Fi lost, reconnecting...");
+        }
+    }
+    if (!up) return nullptr;
+    if (server.hasClient()) {
+        WiFiClient incoming = server.available();
+        if (clientConnected) {
+            incoming.println("Busy: another client is connected.");
+            incoming.stop();
+        } else {
+            client = incoming;
+            client.setNoDelay(true);
+            clientConnected = true;
+            clientLine.length = 0;
+            console.setMirror(&client);
+            console.printf("Remote client connected from %s\n", client.remoteIP().toString().c_str());
+        }
+    }
+    if (clientConnected && !client.connected()) {
+        console.setMirror(nullptr);
+        client.stop();
+        clientConnected = false;
+        console.println("Remote client disconnected.");
+    }
+    return clientConnected ? commandRead(clientLine, client) : nullptr;
+}
+
+void printNetInfo() {
+    if (WiFi.status() != WL_CONNECTED) {
+        console.printf("Network: not connected (joining %s)\n", WIFI_SSID);
+    } else {
+        console.printf("Network: %s on %s (RSSI %d dBm), commands on TCP port %d\n", WiFi.localIP().toString().c_str(), WIFI_SSID,
+                       WiFi.RSSI(), NET_COMMAND_PORT);
+    }
+    console.printf("Remote client: %s\n", clientConnected ? client.remoteIP().toString().c_str() : "none");
+    if (active || packetCount > 0) {
+        console.printf("UDP stream%s to %s:%u: %u samples in %u packets, %u dropped\n", active ? "" : " (last)", collector.toString().c_str(),
+                       (unsigned)collectorPort, (unsigned)sentCount, (unsigned)packetCount, (unsigned)droppedCount);
+    }
+}
+
+bool netStreamBegin(const char *host, uint16_t port) {
+    if (active || WiFi.status() != WL_CONNECTED || !collector.fromString(host)) return false;
+    if (netHandle == nullptr &&
+        xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, nullptr, NET_TASK_PRIORITY, &netHandle, NET_CORE) != pdPASS) {
+        netHandle = nullptr;
+        return false;
+    }
+    collectorPort = port;
+    streamRate = sampleRate;
+    frameSeq = 0;
+    expectedIndex = 0;
+    pending = 0;
+    sentCount = 0;
+    droppedCount = 0;
+    packetCount = 0;
+    stopRequested = false;
+    active = true;
+    xTaskNotifyGive(netHandle);
+    return true;
+}
+
+void netStreamEnd() {
+    if (!active) return;
+    stopRequested = true;
+    while (active) delay(1); // The task sends what is left and the end frame
+}
+
+bool netStreamActive() {
+    return active;
+}
+
+uint32_t netStreamSent() {
+    return sentCount;
+}
+
+uint32_t netStreamDropped() {
+    return droppedCount;
+}
+
+uint32_t netStreamPackets() {
+    return packetCount;
+}
+
+#else // Built without WIFI_SSID: the serial port is the only interface
+
+void netBegin() {}
+
+bool netAvailable() {
+    return false;
+}
+
+void netSuspend() {}
+
+char *netCommandPoll() {
+    return nullptr;
+}
+
+void printNetInfo() {
+    console.println("Network: not built in (set WIFI_SSID and WIFI_PASSWORD in build_flags)");
+}
+
+bool netStreamBegin(const char *host, uint16_t port) {
+    return false;
+}
+
+void netStreamEnd() {}
+
+bool netStreamActive() {
+    return false;
+}
+
+uint32_t netStreamSent() {
+    return 0;
+}
+
+uint32_t netStreamDropped() {
+    return 0;
+}
+
+uint32_t netStreamPackets() {
+    return 0;
+}
+
+#endif // WIFI_SSID
@@ -0,0 +1,68 @@
+// =============================
+// Adaptive Oversampling ('samples auto')
+// =============================
+
+#include "oversampling.h"
+#include "console.h"
+#include "adc_dma.h"
+
+bool autoOversampling = false;
+
+static float readMicros = 11.0;             // Cost of one conversion (until measured)
+static uint32_t slipLimitMicros = 0;        // Finishing later than this after the tick is a slip
+static int slips = 0;                       // Slips in a row
+static volatile uint32_t reductions = 0;    // Reductions in the current recording
+static int startSamples = 0;                // adcSamples at the start of the recording
+
+void measureAdcReadCost() {
+    int savedSamples = adcSamples;
+    adcSamples = AUTO_COST_READS;
+    int64_t start = esp_timer_get_time();
+    readSampleHighPrecision(); // Same loop the acquisition task runs
+    readMicros = (float)(esp_timer_get_time() - start) / AUTO_COST_READS;
+    adcSamples = savedSamples;
+    console.printf("ADC conversion: %.2f us (auto oversampling budget)\n", readMicros);
+}
+
+float adcReadMicros() {
+    return readMicros;
+}
+
+int autoSamplesFor(int rateHz) {
+    if (rateHz <= 0) return 1;
+    if (acqMode == ACQ_FAST) {
+        // Every output averages `samples` stream values; the stream rate is the limit
+        return constrain((int)(FAST_MAX_STREAM_RATE / ((uint32_t)rateHz * channelCount)), 1, AUTO_MAX_SAMPLES);
+    }
+    float budget = 1000000.0 / rateHz * AUTO_HEADROOM_PERCENT / 100;
+    int samples = (int)(budget / (readMicros * channelCount));
+    return constrain(samples, 1, AUTO_MAX_SAMPLES);
+}
+
+void autoOversampleBegin(uint32_t periodMicros) {
+    slipLimitMicros = (uint64_t)periodMicros * AUTO_SLIP_PERCENT / 100;
+    slips = 0;
+    reductions = 0;
+    startSamples = adcSamples;
+}
+
+bool autoOversampleCheck(uint32_t lateMicros, uint32_t frameReadMicros, bool missedTick) {
+    if (missedTick || lateMicros + frameReadMicros > slipLimitMicros) {
+        slips++;
+    } else {
+        slips = 0;
+    }
+    if (slips < AUTO_SLIP_LIMIT || adcSamples <= 1) return false;
+    slips = 0;
+    adcSamples = max(1, adcSamples * 3 / 4);
+    reductions = reductions + 1;
+    return true;
+}
+
+uint32_t autoOversampleReductions() {
+    return reductions;
+}
+
+int autoOversampleStartSamples() {
+    return startSamples;
+}
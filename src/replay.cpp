@@ -0,0 +1,299 @@
+// =============================
+// DMA Replay Engine
+// =============================
+
+#include "replay.h"
+#include "recorder.h"
+#include "sampler.h"
+#include "compress.h"
+#include "storage.h"
+#include "interpolator.h"
+#include <driver/i2s.h>      // I2S driver (built-in DAC mode)
+#include <driver/dac.h>      // ESP32 DAC driver for analog output
+
+static TaskHandle_t feederHandle = nullptr;  // Task filling the DMA buffers
+static volatile bool stopRequested = false;  // Set by replayStop()
+static volatile bool active = false;         // Feeder task running
+static volatile uint32_t position = 0;       // Samples written to the DMA so far (all passes)
+static volatile uint32_t pass = 0;           // Pass currently being written
+static uint32_t passes = 1;                  // Requested passes (0 = until stopped)
+static uint32_t outputRate = 0;              // I2S DAC update rate
+static uint32_t repeat = 1;                  // DAC updates per recorded sample
+static InterpState outputs[2];               // Interpolator for DAC1 / DAC2
+static uint32_t speed = REPLAY_SPEED_ONE;    // Playback speed (REPLAY_SPEED_ONE = as recorded)
+static uint64_t phase = 0;                   // Position of the next DAC update in the current interval (Q32)
+static uint64_t step = 0;                    // Interval advanced per DAC update (Q32): speed / repeat
+
+#define INTERVAL_ONE (1ULL << 32)
+static int64_t durationMicros = 0;           // Duration of the last replay
+static uint32_t rate = 0;                    // Sample rate being replayed
+static uint32_t length = 0;                  // Frames per pass (0 = not known yet)
+static int channels = 1;                     // Samples per frame in the source
+static int dacSlot[2] = { 0, 1 };            // Frame slot driving DAC1 / DAC2 (-1 = off), as set by replaySetDacSlots()
+static int slot1 = 0;                        // Slot driving DAC1 in this replay
+static int slot2 = -1;                       // Slot driving DAC2 in this replay (-1 = DAC2 not used)
+static bool fromFile = false;                // Source is a recording file, not voltageBuffer
+static RecordingReader fileReader;           // File source, read one chunk at a time
+static sample_t chunkSamples[CHUNK_SAMPLES]; // Current chunk of the file source
+static size_t filled = 0;                    // Frames in the current DMA buffer
+static uint32_t writes = 0;                  // DMA buffers written in this replay
+static int64_t lastWrite = 0;                // esp_timer time the previous write returned
+static volatile bool readFailed = false;      // A file pass read no frames, so the replay was ended
+static volatile uint32_t maxJitter = 0;      // Largest deviation of a write interval from the buffer period (us)
+
+// One DMA buffer of stereo frames. The DAC takes the high byte of each
+// 16-bit slot; the first slot is the right channel (DAC1, GPIO25) and the
+// second the left channel (DAC2, GPIO26).
+static uint16_t frames[REPLAY_DMA_BUF_LEN * 2];
+
+// Write one DMA buffer's worth of frames (blocks until the DMA has room)
+static void writeFrames(size_t count) {
+    size_t written = 0;
+    i2s_write(I2S_NUM_0, frames, count * 2 * sizeof(uint16_t), &written, portMAX_DELAY);
+    // Once the DMA ring is full, each write returns when a buffer has been played out,
+    // so the intervals show how steadily the feeder keeps up
+    int64_t now = esp_timer_get_time();
+    if (++writes > REPLAY_DMA_BUF_COUNT + 1 && count == REPLAY_DMA_BUF_LEN) {
+        int32_t deviation = (int32_t)(now - lastWrite) - (int32_t)((uint64_t)REPLAY_DMA_BUF_LEN * 1000000 / outputRate);
+        uint32_t jitter = deviation < 0 ? -deviation : deviation;
+        if (jitter > maxJitter) maxJitter = jitter;
+    }
+    lastWrite = now;
+}
+
+// Feed one frame to the interpolators and queue the DAC updates that fall in
+// each interval it completes (`repeat` of them at normal speed), rendered in
+// runs that fill the DMA buffer
+static void pushFrame(const sample_t *frame) {
+    bool ready = interpPush(outputs[0], frame[slot1]);
+    if (slot2 >= 0) interpPush(outputs[1], frame[slot2]);
+    if (!ready) return;
+    while (phase < INTERVAL_ONE && !stopRequested) {
+        size_t left = (INTERVAL_ONE - phase + step - 1) / step; // Updates left in this interval
+        size_t run = min(left, (size_t)REPLAY_DMA_BUF_LEN - filled);
+        uint16_t *out = frames + 2 * filled;
+        interpRender(outputs[0], (uint32_t)phase, (uint32_t)step, run, out, 2);
+        if (slot2 >= 0) {
+            interpRender(outputs[1], (uint32_t)phase, (uint32_t)step, run, out + 1, 2);
+        } else {
+            for (size_t i = 0; i < run; i++) out[2 * i + 1] = out[2 * i];
+        }
+        phase += run * step;
+        filled += run;
+        if (filled == REPLAY_DMA_BUF_LEN) {
+            writeFrames(filled);
+            filled = 0;
+        }
+    }
+    if (phase >= INTERVAL_ONE) phase -= INTERVAL_ONE; // Above `repeat`x whole intervals are skipped
+}
+
+// Queue one recorded frame
+static void emitFrame(const sample_t *frame) {
+    pushFrame(frame);
+    position = position + 1;
+}
+
+static void feederTask(void *arg) {
+    int64_t start = esp_timer_get_time();
+    int count = sampleCount / channels;
+    filled = 0;
+    SampleReader reader;
+    sample_t frame[MAX_CHANNELS] = {};
+    for (pass = 0; (passes == REPLAY_LOOP_FOREVER || pass < passes) && !stopRequested; pass++) {
+        if (fromFile) {
+            // Stream the file chunk by chunk, so its length is not limited by RAM.
+            // Frames may straddle chunks, so they are assembled across reads.
+            fileReader.rewind();
+            uint32_t passStart = position;
+            size_t n;
+            int slot = 0;
+            while (!stopRequested && (n = fileReader.readChunk(chunkSamples)) > 0) {
+                for (size_t i = 0; i < n && !stopRequested; i++) {
+                    frame[slot++] = chunkSamples[i];
+                    if (slot == channels) {
+                        emitFrame(frame);
+                        slot = 0;
+                    }
+                }
+            }
+            if (!stopRequested && position == passStart) {
+                // No readable chunk (e.g. the first one fails its CRC): nothing would ever block on the DMA
+                readFailed = true;
+                break;
+            }
+            if (pass == 0 && !stopRequested) length = position;
+        } else {
+            // Every pass reads voltageBuffer in place (decompressing as it goes); nothing is copied per loop
+            reader.begin();
+            for (int i = 0; i < count && !stopRequested; i++) {
+                for (int c = 0; c < channels; c++) frame[c] = reader.next();
+                emitFrame(frame);
+            }
+        }
+    }
+    // Repeat the last frame until it has come out of the interpolator's delay line
+    for (int d = interpDelay(outputs[0]); d > 0 && outputs[0].primed && !stopRequested; d--) pushFrame(frame);
+    if (filled > 0) writeFrames(filled);
+    if (fromFile) fileReader.close();
+    // Push zeros through the whole DMA ring so every real sample has been output
+    memset(frames, 0, sizeof(frames));
+    for (int b = 0; b < REPLAY_DMA_BUF_COUNT; b++) writeFrames(REPLAY_DMA_BUF_LEN);
+    durationMicros = esp_timer_get_time() - start;
+
+    i2s_driver_uninstall(I2S_NUM_0);
+    // Hand the DAC back to direct mode at 0V
+    dac_output_enable(DAC_CHANNEL_1);
+    dac_output_voltage(DAC_CHANNEL_1, 0);
+    if (slot2 >= 0) {
+        dac_output_enable(DAC_CHANNEL_2);
+        dac_output_voltage(DAC_CHANNEL_2, 0);
+    }
+    active = false;
+    feederHandle = nullptr;
+    vTaskDelete(nullptr);
+}
+
+// Set up I2S0 for `rate` and start the feeder task on the selected source
+static bool startOutput(uint32_t passCount) {
+    passes = passCount;
+    readFailed = false;
+    // Slots the source does not have fall back to the first channel on DAC1 only
+    slot1 = dacSlot[0] < channels ? dacSlot[0] : 0;
+    slot2 = dacSlot[1] < channels ? dacSlot[1] : -1;
+    // Smallest whole repeat factor that brings the DAC clock up to the I2S minimum,
+    // or to the interpolation rate so interpolated replays have fine steps
+    uint32_t minRate = interpMode == INTERP_HOLD ? REPLAY_MIN_DAC_RATE : REPLAY_INTERP_DAC_RATE;
+    repeat = (minRate + rate - 1) / rate;
+    outputRate = rate * repeat;
+    // Rounded up, so normal speed gives exactly `repeat` updates per interval
+    step = ((uint64_t)speed * INTERVAL_ONE + (uint64_t)REPLAY_SPEED_ONE * repeat - 1) / ((uint64_t)REPLAY_SPEED_ONE * repeat);
+    phase = 0;
+    interpBegin(outputs[0], interpMode, ditherMode, 0x9E3779B9);
+    interpBegin(outputs[1], interpMode, ditherMode, 0x7F4A7C15); // Independent dither on DAC2
+
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN);
+    config.sample_rate = outputRate;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_MSB;
+    config.intr_alloc_flags = 0;
+    config.dma_buf_count = REPLAY_DMA_BUF_COUNT;
+    config.dma_buf_len = REPLAY_DMA_BUF_LEN;
+    config.use_apll = false;
+    config.tx_desc_auto_clear = true; // Output 0V rather than stale data if the feeder ever falls behind
+    if (i2s_driver_install(I2S_NUM_0, &config, 0, nullptr) != ESP_OK) {
+        return false;
+    }
+    // DAC1 / GPIO25, plus DAC2 / GPIO26 when a second channel is mapped to it
+    i2s_set_dac_mode(slot2 >= 0 ? I2S_DAC_CHANNEL_BOTH_EN : I2S_DAC_CHANNEL_RIGHT_EN);
+    i2s_zero_dma_buffer(I2S_NUM_0);
+
+    position = 0;
+    pass = 0;
+    durationMicros = 0;
+    writes = 0;
+    maxJitter = 0;
+    stopRequested = false;
+    active = true;
+    if (xTaskCreatePinnedToCore(feederTask, "replay", REPLAY_TASK_STACK, nullptr, REPLAY_TASK_PRIORITY, &feederHandle, ACQ_CORE) != pdPASS) {
+        i2s_driver_uninstall(I2S_NUM_0);
+        active = false;
+        return false;
+    }
+    return true;
+}
+
+bool replayStart(uint32_t passCount) {
+    if (active || sampleCount == 0 || recordedRate <= 0) return false;
+    fromFile = false;
+    rate = recordedRate;
+    channels = channelCount;
+    length = frameCount();
+    return startOutput(passCount);
+}
+
+bool replayStartFile(fs::FS &fs, const char *path, uint32_t passCount) {
+    if (active || !fileReader.open(fs, path)) return false;
+    fromFile = true;
+    rate = fileReader.header().sampleRate;
+    channels = fileReader.header().channels;
+    length = fileReader.header().count / channels; // 0 for an unfinished file: learned after the first pass
+    if (!startOutput(passCount)) {
+        fileReader.close();
+        return false;
+    }
+    return true;
+}
+
+void replayStop() {
+    if (!active) return;
+    stopRequested = true;
+    while (active) vTaskDelay(1); // The feeder drains the DMA and releases I2S0
+}
+
+void replaySetDacSlots(int dac1, int dac2) {
+    dacSlot[0] = dac1;
+    dacSlot[1] = dac2;
+}
+
+int replayDacSlot(int dac) {
+    return dacSlot[dac];
+}
+
+int replayOutputSlot(int dac) {
+    return dac == 0 ? slot1 : slot2;
+}
+
+void replaySetSpeed(uint32_t newSpeed) {
+    speed = constrain(newSpeed, (uint32_t)REPLAY_SPEED_MIN, (uint32_t)REPLAY_SPEED_MAX);
+}
+
+uint32_t replaySpeed() {
+    return speed;
+}
+
+bool replayActive() {
+    return active;
+}
+
+uint32_t replayPosition() {
+    return position;
+}
+
+uint32_t replayLength() {
+    return length;
+}
+
+uint32_t replaySampleRate() {
+    return rate;
+}
+
+uint32_t replayPass() {
+    return pass;
+}
+
+uint32_t replayPasses() {
+    return passes;
+}
+
+uint32_t replayOutputRate() {
+    return outputRate;
+}
+
+uint32_t replayRepeat() {
+    return repeat;
+}
+
+uint32_t replayMaxJitterMicros() {
+    return maxJitter;
+}
+
+bool replayReadFailed() {
+    return readFailed;
+}
+
+int64_t replayDurationMicros() {
+    return durationMicros;
+}
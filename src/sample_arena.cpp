@@ -0,0 +1,71 @@
+// =============================
+// Runtime-Sized Sample Arena
+// =============================
+
+#include "sample_arena.h"
+#include "console.h"
+#include "recorder.h"
+#include <esp_heap_caps.h>   // Heap capability queries (PSRAM / internal DRAM)
+
+static size_t arenaBytes = 0;    // Size of the current allocation
+static bool arenaPsram = false;  // Location of the current allocation
+
+bool allocateSampleArena(uint32_t capKB) {
+    if (voltageBuffer != nullptr) {
+        heap_caps_free(voltageBuffer);
+        voltageBuffer = nullptr;
+    }
+    sampleCount = 0;
+    maxSamples = 0;
+    arenaBytes = 0;
+
+    size_t bytes;
+    uint32_t caps;
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0) {
+        // PSRAM is not needed by anything else, so the arena can have all of it
+        caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+        bytes = heap_caps_get_largest_free_block(caps);
+    } else {
+        // Internal DRAM: take the largest block, but never eat into the reserve
+        caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        size_t freeBytes = heap_caps_get_free_size(caps);
+        bytes = heap_caps_get_largest_free_block(caps);
+        if (freeBytes < ARENA_RESERVE_BYTES) {
+            bytes = 0;
+        } else if (bytes > freeBytes - ARENA_RESERVE_BYTES) {
+            bytes = freeBytes - ARENA_RESERVE_BYTES;
+        }
+    }
+    if (capKB > 0 && bytes > capKB * 1024UL) bytes = capKB * 1024UL;
+    bytes -= bytes % sizeof(sample_t);
+    if (bytes < ARENA_MIN_BYTES) {
+        console.println("ERROR: Not enough free memory for the sample arena!");
+        return false;
+    }
+
+    voltageBuffer = (sample_t *)heap_caps_malloc(bytes, caps);
+    if (voltageBuffer == nullptr) {
+        console.println("ERROR: Sample arena allocation failed!");
+        return false;
+    }
+    arenaBytes = bytes;
+    arenaPsram = (caps & MALLOC_CAP_SPIRAM) != 0;
+    maxSamples = bytes / sizeof(sample_t);
+    return true;
+}
+
+size_t sampleArenaBytes() {
+    return arenaBytes;
+}
+
+bool sampleArenaInPsram() {
+    return arenaPsram;
+}
+
+void printArenaInfo() {
+    console.printf("Sample arena: %d samples (%.1f KB in %s)\n", maxSamples, arenaBytes / 1024.0, arenaPsram ? "PSRAM" : "DRAM");
+    // Every frame takes one sample per channel
+    console.printf("At %d Hz that is %.1f seconds of recording", sampleRate, (float)maxSamples / channelCount / sampleRate);
+    if (channelCount > 1) console.printf(" on %d channels", channelCount);
+    console.println();
+}
@@ -0,0 +1,420 @@
+// =============================
+// Timer-Driven Sampling Engine
+// =============================
+// The esp_timer callback does nothing but wake the acquisition task. All ADC
+// work happens in that task, never in loop(), so the serial UI can take as
+// long as it likes without shifting the sample schedule.
+// =============================
+
+#include "sampler.h"
+#include "console.h"
+#include "recorder.h"
+#include "adc_dma.h"
+#include "decimator.h"
+#include "calibration.h"
+#include "trigger.h"
+#include "compress.h"
+#include "timing.h"
+#include "oversampling.h"
+#include "envelope.h"
+#include <algorithm>
+
+#define ACQ_TASK_STACK 4096     // Acquisition task stack size (bytes)
+#define ACQ_TASK_PRIORITY 20    // Well above loopTask (1); only system tasks outrank it
+
+SpscRing<LiveSample, LIVE_RING_SIZE> liveRing;   // Acquisition task -> UI
+
+static esp_timer_handle_t sampleTimer = nullptr; // Sample clock (one-shot, re-armed for every tick)
+static TaskHandle_t acqTaskHandle = nullptr;     // Task that takes the samples
+static volatile bool bufferFull = false;         // Set by the acquisition task when voltageBuffer is full
+static volatile uint32_t missedTicks = 0;        // Ticks lost because a sample took longer than one period
+static uint32_t periodMicros = 0;                // Active sample period (0 when stopped)
+static volatile bool fastRequested = false;      // Fast (DMA) acquisition has been asked to run
+static volatile bool fastActive = false;         // Acquisition task is inside the fast (DMA) loop
+static uint32_t decimation = 1;                  // Fast mode: ADC stream samples per output sample
+static uint32_t streamRate = 0;                  // Fast mode: ADC stream rate in Hz
+static volatile bool storing = true;             // Store samples in voltageBuffer (false while streaming)
+static volatile bool running = false;            // Precise mode: between samplerStart() and samplerStop()
+static volatile bool busy = false;               // Precise mode: a sample is being taken and stored
+static uint32_t acquiredCount = 0;               // Samples acquired since samplerStart() (stored or not)
+static uint32_t tickCount = 0;                   // Precise mode: ticks since samplerStart() (the first is sample 0)
+static uint64_t timerTicks = 0;                  // Precise mode: index of the tick the timer is armed for
+static int64_t startMicros = 0;                  // esp_timer time of samplerStart()
+static int activeRate = 0;                       // Sample rate the sampler was started with
+static RunningStats stats;                       // Running statistics (written by the acquisition task)
+static std::atomic<uint32_t> statsSeq{0};        // Seqlock: odd while stats is being updated
+static bool triggered = false;                   // Triggered capture: voltageBuffer is a circular buffer
+static TriggerConfig activeTrigger;              // Trigger settings captured at samplerStart()
+static uint32_t ringSize = 0;                    // Triggered: pre + post
+static uint32_t ringPos = 0;                     // Triggered: next write position in voltageBuffer
+static uint32_t held = 0;                        // Triggered: samples held so far (saturates at pre)
+static uint32_t postLeft = 0;                    // Triggered: samples still to take after the trigger
+static volatile bool fired = false;              // Triggered: the trigger condition has been met
+static uint32_t triggerIndex = 0;                // Triggered: acquiredCount of the trigger sample
+static sample_t prevSample = 0;                  // Previous sample, for edge triggers
+
+// Microseconds from samplerStart() to precise-mode tick `tick`. Worked out
+// from the rate rather than summing a whole-microsecond period, so rates that
+// do not divide 1 MHz keep their nominal rate instead of running fast.
+static inline uint64_t tickDueMicros(uint64_t tick) {
+    return tick * 1000000 / activeRate;
+}
+
+// Arm the timer for tick timerTicks (at once if that is already overdue)
+static bool armNextTick() {
+    int64_t wait = startMicros + (int64_t)tickDueMicros(timerTicks) - esp_timer_get_time();
+    return esp_timer_start_once(sampleTimer, wait > 0 ? wait : 0) == ESP_OK;
+}
+
+// Timer callback (runs in the esp_timer task): signal the acquisition task
+// and arm the next tick.
+static void onSampleTimer(void *arg) {
+    if (!running) return;
+    xTaskNotifyGive(acqTaskHandle);
+    timerTicks++;
+    armNextTick();
+}
+
+// Where storeFrame() puts each frame. The target and channel count are fixed
+// for a whole capture, so samplerStart() picks a storeFrameTo<> instantiation
+// once and the per-frame path has no mode checks left in it.
+enum StoreTarget {
+    STORE_LIVE,         // liveRing only (streaming, record-to-file)
+    STORE_RING,         // Triggered capture: circular buffer, single-channel
+    STORE_COMPRESSED,   // Delta/RLE tokens (compress.h)
+    STORE_RAW           // Plain interleaved frames
+};
+
+typedef void (*StoreFrameFn)(const sample_t *frame, uint32_t timeMicros);
+
+// Append one frame (one sample per channel) to voltageBuffer, and its first
+// channel to liveRing (acquisition task only). Channels = 0 takes the count
+// from channelCount; any other value is a compile-time frame width.
+template <StoreTarget Target, int Channels>
+static void storeFrameTo(const sample_t *frame, uint32_t timeMicros) {
+    const int channels = Channels > 0 ? Channels : channelCount;
+    sample_t sample = frame[0];
+    // Seqlock write: readers on the other core retry if they overlap this update
+    statsSeq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    stats.add(sample);
+    std::atomic_thread_fence(std::memory_order_release);
+    statsSeq.fetch_add(1, std::memory_order_relaxed);
+    if constexpr (Target == STORE_RING) {
+        voltageBuffer[ringPos] = sample;
+        if (++ringPos == ringSize) ringPos = 0;
+        if (fired) {
+            if (--postLeft == 0) bufferFull = true;
+        } else if (held < activeTrigger.pre) {
+            held++;
+        } else if (acquiredCount > 0 && triggerFires(activeTrigger, prevSample, sample)) {
+            fired = true;
+            triggerIndex = acquiredCount;
+            postLeft = activeTrigger.post - 1; // The trigger sample is the first post sample
+            if (postLeft == 0) bufferFull = true;
+        }
+        prevSample = sample;
+    } else if constexpr (Target == STORE_COMPRESSED) {
+        if (compressHasRoom(channels)) {
+            timingStamp(sampleCount / channels, timeMicros);
+            for (int c = 0; c < channels; c++) compressAppend(frame[c]);
+            sampleCount = sampleCount + channels;
+            envelopeAdd(frame);
+        } else {
+            bufferFull = true;
+        }
+    } else if constexpr (Target == STORE_RAW) {
+        int n = sampleCount;
+        timingStamp(n / channels, timeMicros);
+        for (int c = 0; c < channels; c++) voltageBuffer[n + c] = frame[c]; // Store voltages in buffer
+        n += channels;
+        sampleCount = n; // Publish the frame only after it is stored
+        envelopeAdd(frame);
+        if (n + channels > maxSamples) bufferFull = true;
+    }
+    LiveSample live = { acquiredCount++, timeMicros, sample };
+    liveRing.push(live); // Never blocks; a lagging UI only loses live updates
+}
+
+// One channel and the profile's full MAX_CHANNELS each get their own
+// instantiation; other widths share the generic one. Builds with
+// MAX_CHANNELS 1 compile only the single-channel path.
+template <StoreTarget Target>
+static StoreFrameFn storeFrameFor(int channels) {
+    if constexpr (MAX_CHANNELS > 1) {
+        if (channels == MAX_CHANNELS) return storeFrameTo<Target, MAX_CHANNELS>;
+        if (channels > 1) return storeFrameTo<Target, 0>;
+    }
+    return storeFrameTo<Target, 1>;
+}
+
+static StoreFrameFn storeFrame = storeFrameTo<STORE_LIVE, 1>; // Set by samplerStart()
+
+// Fast mode: stream ADC1 through I2S DMA and run each finished block through
+// the decimation filters, storing one output per `decimation` stream samples
+// of each channel. Runs until samplerStop().
+static void acquireFast() {
+    static uint16_t raw[ADC_DMA_BUF_LEN];      // One DMA buffer worth of DMA words
+    static uint16_t codes[ADC_DMA_BUF_LEN + MAX_CHANNELS]; // The block split by channel slot
+    static uint32_t filtered[ADC_DMA_BUF_LEN + 4 * MAX_CHANNELS]; // Filter outputs by slot, carried until a frame is complete
+    int channels = channelCount;
+    uint8_t slotOf[16];                        // Slot of each channel number in a DMA word (0xFF = not recorded)
+    memset(slotOf, 0xFF, sizeof(slotOf));
+    for (int c = 0; c < channels; c++) slotOf[channelList[c]] = c;
+    // The scan gives each slot an equal share of every block, give or take one word
+    size_t codeRegion = ADC_DMA_BUF_LEN / channels + 1;
+    size_t outRegion = ADC_DMA_BUF_LEN / channels + 4;
+    size_t codeCount[MAX_CHANNELS];
+    size_t outCount[MAX_CHANNELS] = {};
+    decimatorBegin(filterType, decimation);
+    if (!adcDmaStart(streamRate)) {
+        fastRequested = false;
+        return;
+    }
+    uint32_t blockMicros = (uint64_t)ADC_DMA_BUF_LEN * 1000000 / streamRate;
+    uint32_t blocks = 0;
+    uint32_t base = 0;                         // When block 0 started converting (the DMA start-up is not jitter)
+    while (fastRequested) {
+        size_t count = adcDmaRead(raw, ADC_DMA_BUF_LEN, 100);
+        uint32_t arrived = esp_timer_get_time() - startMicros;
+        memset(codeCount, 0, sizeof(codeCount));
+        for (size_t i = 0; i < count; i++) {
+            uint8_t slot = slotOf[adcDmaChannel(raw[i])];
+            if (slot < channels && codeCount[slot] < codeRegion) codes[slot * codeRegion + codeCount[slot]++] = adcDmaCode(raw[i]);
+        }
+        size_t frames = SIZE_MAX;
+        for (int c = 0; c < channels; c++) {
+            uint32_t *out = filtered + c * outRegion;
+            outCount[c] += decimatorProcess(c, codes + c * codeRegion, codeCount[c], out + outCount[c], outRegion - outCount[c]);
+            frames = min(frames, outCount[c]);
+        }
+        sample_t frame[MAX_CHANNELS];
+        size_t stored = 0;
+        for (; stored < frames && !bufferFull; stored++) {
+            for (int c = 0; c < channels; c++) frame[c] = rawToChannelSample(filtered[c * outRegion + stored], c);
+            // DMA samples are evenly spaced, so the timestamp follows from the index
+            storeFrame(frame, (uint64_t)acquiredCount * 1000000 / activeRate);
+        }
+        // Slots that got one output more than the others keep it for the next frame
+        for (int c = 0; c < channels; c++) {
+            uint32_t *out = filtered + c * outRegion;
+            memmove(out, out + frames, (outCount[c] - frames) * sizeof(uint32_t));
+            outCount[c] -= frames;
+        }
+        // Every dropped DMA buffer is a run of output frames we never saw
+        missedTicks = adcDmaOverflows() * ADC_DMA_BUF_LEN / (decimation * channels);
+        if (count == ADC_DMA_BUF_LEN) {
+            // Block n (counting dropped ones) is due once n + 1 blocks have been converted
+            uint32_t block = blocks++ + adcDmaOverflows();
+            if (blocks == 1) base = arrived - (block + 1) * blockMicros;
+            timingRecord(block, arrived, base + (block + 1) * blockMicros, (uint32_t)(esp_timer_get_time() - startMicros) - arrived);
+        }
+    }
+    adcDmaStop();
+}
+
+// Acquisition task: one sample per timer tick, or the DMA loop in fast mode.
+static void acquisitionTask(void *arg) {
+    for (;;) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Wait for the next tick
+        if (fastRequested) {
+            fastActive = true;
+            if (fastRequested) acquireFast();
+            fastActive = false;
+            continue;
+        }
+        busy = true; // Set before checking, so samplerStop() either sees it or we see !running
+        if (!running || !recording || bufferFull) {
+            busy = false;
+            continue;
+        }
+        // More than one pending tick means the previous sample overran its period
+        if (ticks > 1) missedTicks += ticks - 1;
+        tickCount += ticks;
+        uint32_t timeMicros = esp_timer_get_time() - startMicros;
+        sample_t frame[MAX_CHANNELS];
+        for (int c = 0; c < channelCount; c++) frame[c] = readSampleHighPrecision(c); // Channels are read back to back
+        uint32_t readMicros = (uint32_t)(esp_timer_get_time() - startMicros) - timeMicros;
+        uint32_t scheduled = tickDueMicros(tickCount - 1);
+        timingRecord(acquiredCount, timeMicros, scheduled, readMicros);
+        if (autoOversampling) {
+            int32_t late = (int32_t)(timeMicros - scheduled); // Signed, so an early tick or the 32-bit wrap is not "late"
+            autoOversampleCheck(late > 0 ? late : 0, readMicros, ticks > 1); // May lower adcSamples for the next tick
+        }
+        storeFrame(frame, timeMicros);
+        busy = false;
+    }
+}
+
+void setupSampler() {
+    xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQ_TASK_STACK, nullptr, ACQ_TASK_PRIORITY, &acqTaskHandle, ACQ_CORE);
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = onSampleTimer;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "sample";
+    esp_timer_create(&timerArgs, &sampleTimer);
+    console.printf("Sampler: acquisition on core %d, serial/UI on core %d\n", ACQ_CORE, (int)xPortGetCoreID());
+}
+
+bool samplerStart(int rateHz) {
+    if (rateHz <= 0) return false;
+    samplerStop();
+    bufferFull = false;
+    missedTicks = 0;
+    acquiredCount = 0;
+    activeRate = rateHz;
+    samplerResetStats();
+    if (autoOversampling) adcSamples = autoSamplesFor(rateHz);
+    autoOversampleBegin(1000000UL / rateHz);
+    if (triggered) {
+        activeTrigger = triggerConfig;
+        activeTrigger.post = triggerPostSamples();
+        ringSize = activeTrigger.pre + activeTrigger.post;
+        if (activeTrigger.type == TRIG_OFF || activeTrigger.post == 0 || ringSize > (uint32_t)maxSamples) return false;
+        ringPos = 0;
+        held = 0;
+        postLeft = 0;
+        fired = false;
+        triggerIndex = 0;
+    }
+    // Discard any stale tick (this runs in the caller, so clear the acquisition task's notification)
+    xTaskNotifyStateClear(acqTaskHandle);
+    ulTaskNotifyValueClear(acqTaskHandle, UINT32_MAX);
+    periodMicros = 1000000UL / rateHz;
+    tickCount = 0;
+    if (!storing) {
+        storeFrame = storeFrameTo<STORE_LIVE, 1>;
+    } else if (triggered) {
+        storeFrame = storeFrameTo<STORE_RING, 1>; // Triggered captures are single-channel
+    } else if (storageCompressed) {
+        storeFrame = storeFrameFor<STORE_COMPRESSED>(channelCount);
+    } else {
+        storeFrame = storeFrameFor<STORE_RAW>(channelCount);
+    }
+    if (storing) recordedRate = rateHz; // voltageBuffer now holds samples at this rate
+    if (storing && !triggered) {
+        // Compressed recordings can hold more frames than the arena has sample slots
+        uint32_t frameCapacity = (uint32_t)maxSamples / channelCount * (storageCompressed ? 4 : 1);
+        timingBeginStamps(frameCapacity);
+        envelopeBegin(frameCapacity, channelCount);
+    } else {
+        timingClearStamps(); // A circular buffer is unrolled afterwards; its times are nominal
+    }
+    if (acqMode == ACQ_FAST) {
+        // Oversample by adcSamples, but keep the stream inside the I2S ADC's usable
+        // range. The scan shares the stream between the channels.
+        uint32_t scanRate = (uint32_t)rateHz * channelCount; // Stream rate at decimation 1
+        decimation = adcSamples;
+        uint32_t minDecimation = (FAST_MIN_STREAM_RATE + scanRate - 1) / scanRate;
+        if (decimation < minDecimation) decimation = minDecimation;
+        if (scanRate * decimation > FAST_MAX_STREAM_RATE) decimation = max(1u, FAST_MAX_STREAM_RATE / scanRate);
+        if (filterType == FILTER_FIR && (decimation & 1)) {
+            // The half-band stage decimates by 2, so the total must be even
+            decimation += (scanRate * (decimation + 1) <= FAST_MAX_STREAM_RATE) ? 1 : -1;
+            if (decimation < 2) decimation = 2;
+        }
+        streamRate = scanRate * decimation;
+        timingReset((uint64_t)ADC_DMA_BUF_LEN * 1000000 / streamRate, true);
+        startMicros = esp_timer_get_time();
+        fastRequested = true;
+        xTaskNotifyGive(acqTaskHandle); // The acquisition task owns the DMA stream
+        return true;
+    }
+    timingReset(periodMicros, false);
+    startMicros = esp_timer_get_time();
+    running = true;
+    xTaskNotifyGive(acqTaskHandle); // Take sample 0 immediately...
+    timerTicks = 1;
+    return armNextTick(); // ...then each tick on its own schedule
+}
+
+void samplerStop() {
+    if (periodMicros == 0) return;
+    if (fastRequested || fastActive) {
+        fastRequested = false;
+        while (fastActive) vTaskDelay(1); // Wait for the DMA loop to release I2S0
+    } else {
+        running = false;
+        esp_timer_stop(sampleTimer);
+        while (busy) vTaskDelay(1); // Let the sample in progress finish storing
+        esp_timer_stop(sampleTimer); // A callback already past its running check may have re-armed once
+    }
+    periodMicros = 0;
+    streamRate = 0;
+}
+
+bool samplerBufferFull() {
+    return bufferFull;
+}
+
+uint32_t samplerMissedTicks() {
+    return missedTicks;
+}
+
+uint32_t samplerPeriodMicros() {
+    return periodMicros;
+}
+
+uint32_t samplerStreamRate() {
+    return streamRate;
+}
+
+uint32_t samplerDecimation() {
+    return decimation;
+}
+
+void samplerSetStoring(bool enable) {
+    storing = enable;
+}
+
+void samplerSetTriggered(bool enable) {
+    triggered = enable;
+}
+
+bool samplerTriggered() {
+    return fired;
+}
+
+uint32_t samplerTriggerIndex() {
+    return triggerIndex;
+}
+
+int samplerFinishCapture() {
+    if (!fired) {
+        sampleCount = 0;
+        samplerResetStats();
+        return 0;
+    }
+    // Pre samples plus however much of the post window was taken (all of it unless stopped early)
+    uint32_t kept = activeTrigger.pre + (activeTrigger.post - postLeft);
+    uint32_t oldest = (ringPos + ringSize - kept) % ringSize;
+    std::rotate(voltageBuffer, voltageBuffer + oldest, voltageBuffer + ringSize); // Oldest sample first (times are nominal)
+    sampleCount = kept;
+    samplerRebuildStats();
+    return kept;
+}
+
+void samplerGetStats(RunningStats &out) {
+    uint32_t before, after;
+    do {
+        before = statsSeq.load(std::memory_order_acquire);
+        out = stats;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = statsSeq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+void samplerResetStats() {
+    stats.reset();
+}
+
+void samplerRebuildStats() {
+    stats.reset();
+    SampleReader reader;
+    reader.begin();
+    for (int i = 0; i < sampleCount; i++) {
+        sample_t sample = reader.next();
+        if (i % channelCount == 0) stats.add(sample); // First channel of each frame
+    }
+    envelopeRebuild();
+}
@@ -0,0 +1,51 @@
+// =============================
+// SD Card Recording Backend
+// =============================
+
+#include "sd_card.h"
+#include "console.h"
+#include <SD.h>
+#include <SPI.h>
+
+static bool mounted = false;
+static uint16_t syncBlocks = SD_SYNC_BLOCKS;
+
+bool sdBegin() {
+    if (mounted) SD.end();
+    mounted = SD.begin(SD_CS_PIN, SPI, SD_SPI_FREQ) && SD.cardType() != CARD_NONE;
+    return mounted;
+}
+
+bool sdMounted() {
+    return mounted;
+}
+
+fs::FS &sdFileSystem() {
+    return SD;
+}
+
+FileSinkConfig sdSinkConfig() {
+    FileSinkConfig config = { SD_BUFFERS, syncBlocks, true };
+    return config;
+}
+
+void sdSetSyncBlocks(uint16_t blocks) {
+    syncBlocks = blocks;
+}
+
+void printSdInfo() {
+    if (!mounted) {
+        console.printf("SD card: not mounted (CS GPIO%d). Insert a card and type 'sd'.\n", SD_CS_PIN);
+        return;
+    }
+    const char *type = "unknown";
+    switch (SD.cardType()) {
+        case CARD_MMC:  type = "MMC"; break;
+        case CARD_SD:   type = "SDSC"; break;
+        case CARD_SDHC: type = "SDHC/SDXC"; break;
+        default: break;
+    }
+    console.printf("SD card: %s, %.1f MB used of %.1f MB\n", type, SD.usedBytes() / 1048576.0, SD.totalBytes() / 1048576.0);
+    console.printf("SD recording: %d blocks buffered, flush every %u blocks%s\n", SD_BUFFERS, (unsigned)syncBlocks,
+                  syncBlocks == 0 ? " (only at the end)" : "");
+}
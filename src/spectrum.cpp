@@ -0,0 +1,262 @@
+// =============================
+// Spectrum Analysis
+// =============================
+
+#include "spectrum.h"
+#include "console.h"
+#include "compress.h"
+#include "const_math.h"
+
+WindowType spectrumWindow = WINDOW_HANN;
+
+// w[n] = a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x) + a4 cos(4x), x = 2 pi n / N
+struct WindowShape {
+    const char *name;
+    float a[5];
+    uint32_t lobe;  // Bins either side of a tone that hold its main lobe
+};
+
+static const WindowShape shapes[] = {
+    { "rect",     { 1.0f, 0, 0, 0, 0 }, 1 },
+    { "hann",     { 0.5f, 0.5f, 0, 0, 0 }, 2 },
+    { "blackman", { 0.35875f, 0.48829f, 0.14128f, 0.01168f, 0 }, 4 },
+    { "flattop",  { 0.21557895f, 0.41663158f, 0.277263158f, 0.083578947f, 0.006947368f }, 5 },
+};
+
+static constexpr float kTwoPi = (float)(2 * kPi);
+
+// Samples, then N/2 complex points (re, im interleaved), then bin powers
+static float scratch[SPECTRUM_MAX_POINTS];
+static float powerScale = 0;    // |X|^2 -> volts^2 RMS per bin
+
+const char *windowName(WindowType type) {
+    return shapes[type].name;
+}
+
+static float windowAt(const WindowShape &shape, uint32_t n, uint32_t points) {
+    // Higher harmonics of the cosine from the first (Chebyshev recurrence), one cosf per sample
+    float c1 = cosf(kTwoPi * n / points);
+    float c2 = 2 * c1 * c1 - 1;
+    float c3 = 2 * c1 * c2 - c1;
+    float c4 = 2 * c2 * c2 - 1;
+    const float *a = shape.a;
+    return a[0] - a[1] * c1 + a[2] * c2 - a[3] * c3 + a[4] * c4;
+}
+
+// In-place radix-2 FFT of m complex points
+static void fftComplex(float *data, uint32_t m) {
+    for (uint32_t i = 1, j = 0; i < m; i++) {
+        uint32_t bit = m >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+    for (uint32_t length = 2; length <= m; length <<= 1) {
+        uint32_t half = length / 2;
+        for (uint32_t k = 0; k < half; k++) {
+            // One twiddle per butterfly position: about m sin/cos pairs over the whole transform
+            float angle = -kTwoPi * k / length;
+            float wr = cosf(angle), wi = sinf(angle);
+            for (uint32_t i = k; i < m; i += length) {
+                float *a = data + 2 * i;
+                float *b = data + 2 * (i + half);
+                float tr = wr * b[0] - wi * b[1];
+                float ti = wr * b[1] + wi * b[0];
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+// Turn the N/2-point transform of the packed real samples into one-sided
+// bin powers |X[k]|^2, k = 0..N/2, in place: bin k lands in scratch[2k] and
+// the Nyquist bin in scratch[1]. Bins k and N/2 - k depend on the same two
+// complex points, so each pair is computed together.
+static void splitRealSpectrum(uint32_t points) {
+    uint32_t m = points / 2;
+    float dc = scratch[0] + scratch[1];
+    float nyquist = scratch[0] - scratch[1];
+    scratch[0] = dc * dc;
+    scratch[1] = nyquist * nyquist;
+    for (uint32_t k = 1; k <= m / 2; k++) {
+        float zr = scratch[2 * k], zi = scratch[2 * k + 1];
+        float yr = scratch[2 * (m - k)], yi = scratch[2 * (m - k) + 1];
+        float er = (zr + yr) / 2, ei = (zi - yi) / 2;     // Even samples' transform
+        float orr = (zi + yi) / 2, oi = -(zr - yr) / 2;   // Odd samples' transform
+        float angle = -kTwoPi * k / points;
+        float wr = cosf(angle), wi = sinf(angle);
+        float tr = wr * orr - wi * oi;
+        float ti = wr * oi + wi * orr;
+        scratch[2 * k] = (er + tr) * (er + tr) + (ei + ti) * (ei + ti);
+        scratch[2 * (m - k)] = (er - tr) * (er - tr) + (ei - ti) * (ei - ti); // X[m-k] = conj(E - W O)
+    }
+}
+
+// Volts^2 RMS in bin k (0..points/2)
+static inline float binPower(uint32_t k, uint32_t points) {
+    return powerScale * (k == points / 2 ? scratch[1] : scratch[2 * k]);
+}
+
+// Power of a tone: its bin plus `lobe` bins either side (DC excluded)
+static float lobePower(uint32_t center, uint32_t lobe, uint32_t points) {
+    uint32_t first = center > lobe ? center - lobe : 1;
+    uint32_t last = min(center + lobe, points / 2);
+    float sum = 0;
+    for (uint32_t k = first; k <= last; k++) sum += binPower(k, points);
+    return sum;
+}
+
+// Largest bin within one bin of `bin` (a harmonic's rounded position can miss its peak)
+static uint32_t nearestPeak(uint32_t bin, uint32_t points) {
+    uint32_t best = bin;
+    if (bin > 1 && binPower(bin - 1, points) > binPower(best, points)) best = bin - 1;
+    if (bin < points / 2 && binPower(bin + 1, points) > binPower(best, points)) best = bin + 1;
+    return best;
+}
+
+static inline float toDb(float power) {
+    return 10 * log10f(max(power, 1e-20f));
+}
+
+bool spectrumAnalyze(uint32_t firstFrame, uint32_t points, int slot, WindowType window, SpectrumResult &result) {
+    if (points < SPECTRUM_MIN_POINTS || points > SPECTRUM_MAX_POINTS || (points & (points - 1)) != 0 ||
+        slot < 0 || slot >= channelCount || firstFrame + points > (uint32_t)frameCount()) {
+        return false;
+    }
+    const WindowShape &shape = shapes[window];
+    uint32_t m = points / 2;
+
+    // One channel of the window, in volts
+    if (storageCompressed) {
+        SampleReader reader; // Sequential only, so walk up to the window
+        reader.begin();
+        for (uint32_t i = 0; i < firstFrame * channelCount; i++) reader.next();
+        for (uint32_t i = 0; i < points; i++) {
+            for (int c = 0; c < channelCount; c++) {
+                sample_t sample = reader.next();
+                if (c == slot) scratch[i] = sampleToVolts(sample);
+            }
+        }
+    } else {
+        const sample_t *frame = voltageBuffer + firstFrame * channelCount + slot;
+        for (uint32_t i = 0; i < points; i++) scratch[i] = sampleToVolts(frame[i * channelCount]);
+    }
+    double sum = 0;
+    for (uint32_t i = 0; i < points; i++) sum += scratch[i];
+    float mean = sum / points;
+    float windowSumSq = 0;
+    for (uint32_t i = 0; i < points; i++) {
+        float w = windowAt(shape, i, points);
+        scratch[i] = (scratch[i] - mean) * w;
+        windowSumSq += w * w;
+    }
+    // Even samples are the real parts and odd samples the imaginary parts of m complex points
+    fftComplex(scratch, m);
+    splitRealSpectrum(points);
+    powerScale = 2.0f / ((float)points * windowSumSq); // Parseval: one-sided bin powers sum to the mean square
+
+    result = {};
+    result.points = points;
+    result.firstFrame = firstFrame;
+    result.binHz = (float)recordedRate / points;
+    result.dc = mean;
+
+    // Strongest local maxima above the DC lobe
+    uint32_t peakBins[SPECTRUM_PEAKS];
+    for (uint32_t k = shape.lobe + 1; k < m; k++) {
+        float p = binPower(k, points);
+        if (p <= binPower(k - 1, points) || p < binPower(k + 1, points)) continue;
+        int at = result.peakCount;
+        while (at > 0 && binPower(peakBins[at - 1], points) < p) at--;
+        if (at >= SPECTRUM_PEAKS) continue;
+        int last = min((int)result.peakCount, SPECTRUM_PEAKS - 1);
+        for (int i = last; i > at; i--) peakBins[i] = peakBins[i - 1];
+        peakBins[at] = k;
+        if (result.peakCount < SPECTRUM_PEAKS) result.peakCount++;
+    }
+    float fractions[SPECTRUM_PEAKS];
+    for (int i = 0; i < result.peakCount; i++) {
+        uint32_t k = peakBins[i];
+        // Parabola through the log powers either side of the peak
+        float a = logf(max(binPower(k - 1, points), 1e-20f));
+        float b = logf(max(binPower(k, points), 1e-20f));
+        float c = logf(max(binPower(k + 1, points), 1e-20f));
+        float denom = a - 2 * b + c;
+        fractions[i] = denom < 0 ? constrain(0.5f * (a - c) / denom, -0.5f, 0.5f) : 0;
+        result.peaks[i].frequency = (k + fractions[i]) * result.binHz;
+        result.peaks[i].rms = sqrtf(lobePower(k, shape.lobe, points));
+    }
+
+    // Harmonics of the strongest tone
+    uint32_t excluded[SPECTRUM_PEAKS + SPECTRUM_HARMONICS]; // Tone and harmonic bins, left out of the noise
+    int excludedCount = 0;
+    for (int i = 0; i < result.peakCount; i++) excluded[excludedCount++] = peakBins[i];
+    float fundamental = 0, harmonicPower = 0;
+    if (result.peakCount > 0) {
+        fundamental = lobePower(peakBins[0], shape.lobe, points);
+        float bin = peakBins[0] + fractions[0];
+        for (int h = 2; h <= SPECTRUM_HARMONICS; h++) {
+            uint32_t center = lroundf(bin * h);
+            if (center >= m) break; // Above Nyquist (aliased harmonics are not folded back)
+            center = nearestPeak(center, points);
+            harmonicPower += lobePower(center, shape.lobe, points);
+            excluded[excludedCount++] = center;
+            result.harmonics++;
+        }
+        if (result.harmonics > 0) result.thdPercent = 100 * sqrtf(harmonicPower / max(fundamental, 1e-20f));
+    }
+
+    // Everything else is noise (the reported tones count as spurs, not noise)
+    float noise = 0;
+    uint32_t noiseBins = 0;
+    for (uint32_t k = shape.lobe + 1; k <= m; k++) {
+        bool tone = false;
+        for (int i = 0; i < excludedCount && !tone; i++) {
+            tone = (k > excluded[i] ? k - excluded[i] : excluded[i] - k) <= shape.lobe;
+        }
+        if (tone) continue;
+        noise += binPower(k, points);
+        noiseBins++;
+    }
+    float perBin = noiseBins > 0 ? noise / noiseBins : 0;
+    result.noiseFloorDb = toDb(perBin);
+    result.noiseRms = sqrtf(perBin * m); // Extrapolated over the bins the tones cover
+    result.snrDb = toDb(fundamental) - toDb(perBin * m);
+    // Local maxima of the noise itself are not tones (the strongest peak is always kept)
+    float minimum = perBin * (2 * shape.lobe + 1) * powf(10, SPECTRUM_PEAK_MIN_DB / 10.0f);
+    while (result.peakCount > 1 && result.peaks[result.peakCount - 1].rms * result.peaks[result.peakCount - 1].rms < minimum) {
+        result.peakCount--;
+    }
+    return true;
+}
+
+void printSpectrum(const SpectrumResult &result) {
+    console.printf("Spectrum: %u points from frame %u at %d Hz (%.3f Hz per bin, %s window)\n", (unsigned)result.points,
+                   (unsigned)result.firstFrame, recordedRate, result.binHz, windowName(spectrumWindow));
+    console.printf("DC: %.4f V\n", result.dc);
+    if (result.peakCount == 0) {
+        console.println("No tones found (flat signal).");
+    }
+    for (int i = 0; i < result.peakCount; i++) {
+        const SpectrumPeak &peak = result.peaks[i];
+        console.printf("Peak %d: %.3f Hz, %.4f V RMS (%.1f dBV)\n", i + 1, peak.frequency, peak.rms, toDb(peak.rms * peak.rms));
+    }
+    if (result.harmonics > 0) {
+        console.printf("THD: %.3f%% (%.1f dB, harmonics 2-%d)\n", result.thdPercent, 20 * log10f(max(result.thdPercent / 100, 1e-10f)),
+                       result.harmonics + 1);
+    } else if (result.peakCount > 0) {
+        console.println("THD: n/a (second harmonic is above Nyquist)");
+    }
+    console.printf("Noise floor: %.1f dBV per bin, %.3f mV RMS in band", result.noiseFloorDb, result.noiseRms * 1000);
+    if (result.peakCount > 0) console.printf(", SNR %.1f dB", result.snrDb);
+    console.println();
+}
@@ -0,0 +1,272 @@
+// =============================
+// Recording Files (LittleFS)
+// =============================
+
+#include "storage.h"
+#include "console.h"
+#include "frame.h"
+#include "compress.h"
+#include "sampler.h"
+#include "channels.h"
+#include "timing.h"
+#include <LittleFS.h>
+#include <ctype.h>
+
+static inline uint16_t getU16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t getU32(const uint8_t *p) {
+    return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+bool storageBegin() {
+    if (!LittleFS.begin(true)) { // true: format the partition if it has never been used
+        console.println("ERROR: Could not mount LittleFS, save/load unavailable.");
+        return false;
+    }
+    console.printf("Flash storage: %.1f KB used of %.1f KB\n", LittleFS.usedBytes() / 1024.0, LittleFS.totalBytes() / 1024.0);
+    return true;
+}
+
+bool recordingPath(const char *name, char *path, size_t size) {
+    size_t length = strlen(name);
+    if (length == 0 || length > RECORDING_NAME_MAX) return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = name[i];
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+    }
+    snprintf(path, size, "/%s%s", name, RECORDING_EXT);
+    return true;
+}
+
+RecordingHeader currentRecordingHeader() {
+    RecordingHeader header = {};
+    header.sampleRate = recordedRate;
+    header.adcSamples = adcSamples;
+    header.offsetUnits = adcOffsetUnits;
+    header.mode = acqMode;
+    header.count = sampleCount;
+    header.dropped = 0;
+    header.chunkSamples = CHUNK_SAMPLES;
+    header.dataOffset = RECORDING_HEADER_BYTES;
+    header.channels = channelCount;
+    header.channelMask = channelMask();
+    return header;
+}
+
+void encodeRecordingHeader(uint8_t *out, const RecordingHeader &header) {
+    memset(out, 0, RECORDING_HEADER_BYTES);
+    memcpy(out, RECORDING_MAGIC, 4);
+    uint8_t *p = out + 4;
+    p = putU8(p, RECORDING_VERSION);
+    p = putU16(p, SAMPLE_UNITS_PER_VOLT);
+    p = putU32(p, header.sampleRate);
+    p = putU16(p, header.adcSamples);
+    p = putU16(p, header.offsetUnits);
+    p = putU8(p, header.mode);
+    p = putU32(p, header.count);
+    p = putU32(p, header.dropped);
+    p = putU16(p, header.chunkSamples);
+    p = putU16(p, header.dataOffset);
+    p = putU8(p, header.flags);
+    p = putU8(p, header.channels);
+    putU8(p, header.channelMask);
+}
+
+size_t encodeChunk(uint8_t *out, uint32_t firstIndex, const sample_t *samples, size_t count) {
+    uint8_t *p = putU32(out, firstIndex);
+    p = putU16(p, count);
+    for (size_t i = 0; i < count; i++) {
+        p = putU16(p, samples[i]);
+    }
+    putU16(p, crc16Update(0xFFFF, out, p - out));
+    return CHUNK_BYTES(count);
+}
+
+// =============================
+// RecordingReader
+// =============================
+bool RecordingReader::open(fs::FS &fs, const char *path) {
+    file = fs.open(path, FILE_READ);
+    if (!file) return false;
+    uint8_t raw[RECORDING_HEADER_BYTES];
+    if (file.read(raw, sizeof(raw)) != sizeof(raw) || memcmp(raw, RECORDING_MAGIC, 4) != 0 ||
+        raw[4] != RECORDING_VERSION || getU16(raw + 5) != SAMPLE_UNITS_PER_VOLT) {
+        file.close();
+        return false;
+    }
+    info.sampleRate = getU32(raw + 7);
+    info.adcSamples = getU16(raw + 11);
+    info.offsetUnits = getU16(raw + 13);
+    info.mode = raw[15];
+    info.count = getU32(raw + 16);
+    info.dropped = getU32(raw + 20);
+    info.chunkSamples = getU16(raw + 24);
+    info.dataOffset = getU16(raw + 26);
+    info.flags = raw[28];
+    info.channels = raw[29] ? raw[29] : 1;
+    info.channelMask = raw[30] ? raw[30] : 1 << ADC1_CHANNEL_0;
+    if (info.channels > MAX_CHANNELS || info.sampleRate == 0 || info.chunkSamples == 0 || info.chunkSamples > CHUNK_SAMPLES) {
+        file.close();
+        return false;
+    }
+    rewind();
+    return true;
+}
+
+void RecordingReader::rewind() {
+    file.seek(info.dataOffset);
+    badChunk = false;
+}
+
+size_t RecordingReader::readChunk(sample_t *out) {
+    if (badChunk || file.read(chunk, CHUNK_HEADER_BYTES) != CHUNK_HEADER_BYTES) return 0;
+    size_t count = getU16(chunk + 4);
+    size_t rest = 2 * count + 2;
+    if (count == 0 || count > info.chunkSamples || file.read(chunk + CHUNK_HEADER_BYTES, rest) != rest ||
+        crc16Update(0xFFFF, chunk, CHUNK_HEADER_BYTES + 2 * count) != getU16(chunk + CHUNK_HEADER_BYTES + 2 * count)) {
+        badChunk = true; // Torn write at the end of an interrupted recording, or corruption
+        return 0;
+    }
+    firstIndex = getU32(chunk);
+    if ((info.flags & RECORDING_FLAG_PADDED) && count < info.chunkSamples) {
+        file.seek(file.position() + CHUNK_BYTES(info.chunkSamples) - CHUNK_BYTES(count)); // Skip the padding
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = getU16(chunk + CHUNK_HEADER_BYTES + 2 * i);
+    }
+    return count;
+}
+
+void RecordingReader::close() {
+    file.close();
+}
+
+// =============================
+// Save / Load / List
+// =============================
+bool saveRecording(const char *name) {
+    char path[RECORDING_NAME_MAX + 8];
+    if (!recordingPath(name, path, sizeof(path))) {
+        console.printf("Invalid name (1-%d characters: letters, digits, _ or -)\n", RECORDING_NAME_MAX);
+        return false;
+    }
+    fs::File file = LittleFS.open(path, FILE_WRITE);
+    if (!file) {
+        console.printf("ERROR: Could not create %s\n", path);
+        return false;
+    }
+    static uint8_t chunk[CHUNK_BYTES(CHUNK_SAMPLES)];
+    static sample_t samples[CHUNK_SAMPLES];
+    int count = sampleCount;
+    encodeRecordingHeader(chunk, currentRecordingHeader());
+    bool ok = file.write(chunk, RECORDING_HEADER_BYTES) == RECORDING_HEADER_BYTES;
+    SampleReader reader; // Compressed recordings are expanded on the way out
+    reader.begin();
+    for (int first = 0; ok && first < count; first += CHUNK_SAMPLES) {
+        size_t n = min(CHUNK_SAMPLES, count - first);
+        for (size_t i = 0; i < n; i++) samples[i] = reader.next();
+        size_t bytes = encodeChunk(chunk, first, samples, n);
+        ok = file.write(chunk, bytes) == bytes;
+    }
+    file.close();
+    if (!ok) {
+        LittleFS.remove(path);
+        console.println("ERROR: Flash full, recording not saved.");
+        return false;
+    }
+    console.printf("Saved %d samples to %s (%.1f KB free)\n", count, path, (LittleFS.totalBytes() - LittleFS.usedBytes()) / 1024.0);
+    return true;
+}
+
+bool loadRecording(const char *name) {
+    char path[RECORDING_NAME_MAX + 8];
+    if (!recordingPath(name, path, sizeof(path)) || !LittleFS.exists(path)) {
+        console.printf("No recording named '%s'. Type 'ls' to list them.\n", name);
+        return false;
+    }
+    static RecordingReader reader; // Holds a 4 KB chunk buffer, so keep it off the loop() stack
+    if (!reader.open(LittleFS, path)) {
+        console.printf("ERROR: %s is not a recording file.\n", path);
+        return false;
+    }
+    // Chunks are copied straight into the arena, uncompressed
+    storageCompressed = false;
+    sampleCount = 0;
+    timingClearStamps(); // Only the sample rate is known for a loaded recording
+    int count = 0;
+    bool truncated = false;
+    static sample_t samples[CHUNK_SAMPLES];
+    size_t n;
+    while ((n = reader.readChunk(samples)) > 0) {
+        if (count + (int)n > maxSamples) {
+            n = maxSamples - count;
+            truncated = true;
+        }
+        memcpy(voltageBuffer + count, samples, n * sizeof(sample_t));
+        count += n;
+        if (truncated) break;
+    }
+    const RecordingHeader &header = reader.header();
+    reader.close();
+    if (header.channels != channelCount || header.channelMask != channelMask()) {
+        setChannelMask(header.channelMask); // The buffer layout follows the recording
+        console.print("Channels set from the recording: ");
+        printChannels();
+        console.println();
+    }
+    sampleCount = count - count % channelCount; // Whole frames only
+    count = sampleCount;
+    recordedRate = header.sampleRate; // Replay and timestamps follow the recording; 'rate' is left alone
+    samplerRebuildStats();
+    console.printf("Loaded %d samples from %s (%u Hz, %u ADC samples, offset %.4f V when recorded)\n", count, path,
+                  (unsigned)header.sampleRate, (unsigned)header.adcSamples, (float)header.offsetUnits / SAMPLE_UNITS_PER_VOLT);
+    if (truncated) {
+        console.printf("WARNING: Only the first %d samples fit in RAM. Use 'play %s' to replay all of it from flash.\n", count, name);
+    } else if (reader.corrupt() || (header.count != 0 && (uint32_t)count != header.count)) {
+        console.println("WARNING: The file ends early (interrupted recording?); loaded every complete chunk.");
+    }
+    return true;
+}
+
+bool removeRecording(const char *name) {
+    char path[RECORDING_NAME_MAX + 8];
+    if (!recordingPath(name, path, sizeof(path)) || !LittleFS.remove(path)) {
+        console.printf("No recording named '%s'.\n", name);
+        return false;
+    }
+    console.printf("Removed %s\n", path);
+    return true;
+}
+
+int listRecordings(fs::FS &fs) {
+    fs::File root = fs.open("/");
+    if (!root || !root.isDirectory()) {
+        console.println("Storage not available.");
+        return 0;
+    }
+    console.println("Name,Samples,Rate(Hz),Size(KB)");
+    int found = 0;
+    for (fs::File entry = root.openNextFile(); entry; entry = root.openNextFile()) {
+        const char *fileName = entry.name();
+        if (*fileName == '/') fileName++;
+        size_t length = strlen(fileName);
+        size_t extLength = strlen(RECORDING_EXT);
+        if (entry.isDirectory() || length <= extLength || strcmp(fileName + length - extLength, RECORDING_EXT) != 0) continue;
+        uint8_t raw[RECORDING_HEADER_BYTES];
+        bool valid = entry.read(raw, sizeof(raw)) == sizeof(raw) && memcmp(raw, RECORDING_MAGIC, 4) == 0;
+        uint32_t count = valid ? getU32(raw + 16) : 0;
+        console.printf("%.*s,", (int)(length - extLength), fileName);
+        if (!valid) {
+            console.print("?,?");
+        } else if (count == 0) {
+            console.printf("(unfinished),%u", (unsigned)getU32(raw + 7));
+        } else {
+            console.printf("%u,%u", (unsigned)count, (unsigned)getU32(raw + 7));
+        }
+        console.printf(",%.1f\n", entry.size() / 1024.0);
+        found++;
+    }
+    return found;
+}
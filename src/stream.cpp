@@ -0,0 +1,97 @@
+// =============================
+// Streaming Record-to-Serial Mode
+// =============================
+
+#include "stream.h"
+#include "frame.h"
+#include "recorder.h"
+#include "sampler.h"
+#include "watch.h"
+
+static bool active = false;           // Streaming in progress
+static uint16_t frameSeq = 0;         // Sequence number of the next data frame
+static uint32_t sentCount = 0;        // Samples sent so far
+static uint32_t expectedIndex = 0;    // Index of the next sample we expect from liveRing
+static uint32_t droppedCount = 0;     // Samples skipped because liveRing overflowed
+static uint16_t pending = 0;          // Samples waiting in the current frame
+static unsigned long pendingSince = 0;// millis() when the first pending sample arrived
+static uint8_t payload[12 + 2 * STREAM_FRAME_SAMPLES]; // Data frame being assembled
+
+// Send the samples collected so far as one data frame
+static void flushFrame() {
+    if (pending == 0) return;
+    uint8_t *p = payload;
+    p = putU16(p, frameSeq++);
+    // first_index / first_time_us were written when the frame was started
+    p += 8;
+    putU16(p, pending);
+    sendFrame(FRAME_STREAM_DATA, payload, 12 + 2 * pending);
+    sentCount += pending;
+    pending = 0;
+}
+
+void streamBegin() {
+    frameSeq = 0;
+    sentCount = 0;
+    expectedIndex = 0;
+    droppedCount = 0;
+    pending = 0;
+    uint8_t start[10];
+    uint8_t *p = start;
+    p = putU8(p, FRAME_FORMAT_VERSION);
+    p = putU16(p, SAMPLE_UNITS_PER_VOLT);
+    p = putU32(p, sampleRate);
+    p = putU16(p, adcSamples);
+    putU8(p, acqMode);
+    sendFrame(FRAME_STREAM_START, start, sizeof(start));
+    active = true;
+}
+
+void streamService() {
+    if (!active) return;
+    LiveSample live;
+    while (liveRing.pop(live)) {
+        // A gap in the indices means liveRing overflowed; start a new frame so
+        // every frame covers a contiguous run of samples
+        if (live.index != expectedIndex) {
+            droppedCount += live.index - expectedIndex;
+            flushFrame();
+        }
+        expectedIndex = live.index + 1;
+        watchSample(live);
+        if (pending == 0) {
+            uint8_t *p = payload + 2;
+            p = putU32(p, live.index);
+            putU32(p, live.micros);
+            pendingSince = millis();
+        }
+        putU16(payload + 12 + 2 * pending, live.sample);
+        if (++pending == STREAM_FRAME_SAMPLES) flushFrame();
+    }
+    // Don't let slow sample rates hold data back for long
+    if (pending > 0 && millis() - pendingSince >= STREAM_FLUSH_MS) flushFrame();
+}
+
+void streamEnd() {
+    if (!active) return;
+    streamService(); // Pick up anything still queued
+    flushFrame();
+    uint8_t end[8];
+    uint8_t *p = end;
+    p = putU32(p, sentCount);
+    putU32(p, droppedCount);
+    sendFrame(FRAME_STREAM_END, end, sizeof(end));
+    active = false;
+}
+
+bool streamActive() {
+    return active;
+}
+
+uint32_t streamSent() {
+    return sentCount;
+}
+
+uint32_t streamDropped() {
+    return droppedCount;
+}
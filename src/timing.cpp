@@ -0,0 +1,148 @@
+// =============================
+// Sample Timing Instrumentation
+// =============================
+
+#include "timing.h"
+#include "console.h"
+#include <atomic>
+
+// Histogram bin upper bounds (us); the last bin collects everything above
+static const uint32_t binLimits[TIMING_BINS - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 5000 };
+
+static TimingStats timing;                   // Written by the acquisition task
+static std::atomic<uint32_t> timingSeq{0};   // Seqlock: odd while timing is being updated
+static uint32_t lastMicros = 0;              // Start of the previous sample/block
+static bool haveLast = false;
+
+static uint32_t stamps[TIMING_MAX_STAMPS];   // esp_timer time (us since start) of every stampBlock-th frame
+static uint32_t stampShift = 0;              // log2 of frames per stamp
+static volatile uint32_t stampCount = 0;     // Stamps recorded
+
+uint32_t timingBinLimit(int bin) {
+    return bin < TIMING_BINS - 1 ? binLimits[bin] : UINT32_MAX;
+}
+
+void timingReset(uint32_t nominalMicros, bool blocks) {
+    timingSeq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(&timing, 0, sizeof(timing));
+    timing.nominalMicros = nominalMicros;
+    timing.blocks = blocks;
+    timing.minInterval = UINT32_MAX;
+    timing.workMin = UINT32_MAX;
+    timing.worstLate = INT32_MIN;
+    std::atomic_thread_fence(std::memory_order_release);
+    timingSeq.fetch_add(1, std::memory_order_relaxed);
+    haveLast = false;
+}
+
+void timingRecord(uint32_t index, uint32_t micros, uint32_t scheduledMicros, uint32_t workMicros) {
+    timingSeq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (haveLast) {
+        uint32_t interval = micros - lastMicros;
+        // A sample that follows missed ticks spans several periods; measure against that
+        uint32_t periods = timing.nominalMicros ? max(1u, (interval + timing.nominalMicros / 2) / timing.nominalMicros) : 1;
+        int32_t deviation = (int32_t)(interval - periods * timing.nominalMicros);
+        uint32_t jitter = deviation < 0 ? -deviation : deviation;
+        int bin = 0;
+        while (bin < TIMING_BINS - 1 && jitter > binLimits[bin]) bin++;
+        timing.histogram[bin]++;
+        if (interval < timing.minInterval) timing.minInterval = interval;
+        if (interval > timing.maxInterval) timing.maxInterval = interval;
+        timing.count++;
+    }
+    int32_t late = (int32_t)(micros - scheduledMicros);
+    if (late > timing.worstLate) {
+        timing.worstLate = late;
+        timing.worstLateIndex = index;
+    }
+    if (late + (int32_t)workMicros > (int32_t)timing.nominalMicros) timing.deadlineMisses++;
+    if (workMicros < timing.workMin) timing.workMin = workMicros;
+    if (workMicros > timing.workMax) timing.workMax = workMicros;
+    timing.workTotal += workMicros;
+    timing.workCount++;
+    std::atomic_thread_fence(std::memory_order_release);
+    timingSeq.fetch_add(1, std::memory_order_relaxed);
+    lastMicros = micros;
+    haveLast = true;
+}
+
+void timingGet(TimingStats &out) {
+    uint32_t before, after;
+    do {
+        before = timingSeq.load(std::memory_order_acquire);
+        out = timing;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = timingSeq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+void printTiming() {
+    TimingStats t;
+    timingGet(t);
+    if (t.workCount == 0) {
+        console.println("No timing data yet. Start a recording first.");
+        return;
+    }
+    const char *unit = t.blocks ? "block" : "sample";
+    console.printf("=== Timing (%s, %u %ss) ===\n", t.blocks ? "fast mode, per DMA block" : "precise mode, per sample", (unsigned)t.workCount, unit);
+    console.printf("Nominal interval: %u us\n", (unsigned)t.nominalMicros);
+    if (t.count > 0) {
+        console.printf("Measured interval: %u - %u us\n", (unsigned)t.minInterval, (unsigned)t.maxInterval);
+        console.println("Jitter(us),Count,Percent");
+        uint32_t low = 0;
+        for (int i = 0; i < TIMING_BINS; i++) {
+            if (t.histogram[i] == 0) {
+                low = timingBinLimit(i) + 1;
+                continue;
+            }
+            if (i == TIMING_BINS - 1) {
+                console.printf(">%u", (unsigned)timingBinLimit(i - 1));
+            } else if (i == 0) {
+                console.printf("0-%u", (unsigned)timingBinLimit(i));
+            } else {
+                console.printf("%u-%u", (unsigned)low, (unsigned)timingBinLimit(i));
+            }
+            console.printf(",%u,%.2f\n", (unsigned)t.histogram[i], 100.0 * t.histogram[i] / t.count);
+            low = timingBinLimit(i) + 1;
+        }
+    }
+    console.printf("Worst late %s: %+ld us (%s %u)\n", unit, (long)t.worstLate, unit, (unsigned)t.worstLateIndex);
+    console.printf("Missed deadlines: %u\n", (unsigned)t.deadlineMisses);
+    console.printf("%s: %u - %u us (avg %.1f us)\n", t.blocks ? "Block processing" : "Reading time",
+                  (unsigned)t.workMin, (unsigned)t.workMax, (double)t.workTotal / t.workCount);
+}
+
+void timingBeginStamps(uint32_t frameCapacity) {
+    stampShift = 0;
+    while ((frameCapacity >> stampShift) >= TIMING_MAX_STAMPS) stampShift++;
+    stampCount = 0;
+}
+
+void timingStamp(uint32_t frame, uint32_t micros) {
+    if (frame & ((1u << stampShift) - 1)) return;
+    uint32_t n = frame >> stampShift;
+    if (n != stampCount || n >= TIMING_MAX_STAMPS) return; // Only ever appends
+    stamps[n] = micros;
+    stampCount = n + 1;
+}
+
+void timingClearStamps() {
+    stampCount = 0;
+}
+
+float sampleTimeMs(uint32_t frame) {
+    uint32_t count = stampCount;
+    uint32_t n = frame >> stampShift;
+    if (count == 0) return (float)frame * 1000.0 / recordedRate;
+    uint32_t offset = frame - (n << stampShift);
+    if (n + 1 < count) {
+        // Between two stamps: interpolate over the block
+        uint32_t span = stamps[n + 1] - stamps[n];
+        return (stamps[n] + (float)span * offset / (1u << stampShift)) / 1000.0;
+    }
+    // After the last stamp: extrapolate at the nominal rate
+    uint32_t last = count - 1;
+    return stamps[last] / 1000.0 + (float)(frame - (last << stampShift)) * 1000.0 / recordedRate;
+}
@@ -0,0 +1,36 @@
+// =============================
+// Triggered Capture
+// =============================
+
+#include "trigger.h"
+#include "console.h"
+
+TriggerConfig triggerConfig = { TRIG_OFF, 0, 0, TRIGGER_DEFAULT_PRE, 0 };
+
+const char *triggerName(TriggerType type) {
+    switch (type) {
+        case TRIG_ABOVE:   return "above";
+        case TRIG_BELOW:   return "below";
+        case TRIG_RISING:  return "rising";
+        case TRIG_FALLING: return "falling";
+        case TRIG_WINDOW:  return "window";
+        default:           return "off";
+    }
+}
+
+uint32_t triggerPostSamples() {
+    if (triggerConfig.post > 0) return triggerConfig.post;
+    return (uint32_t)maxSamples > triggerConfig.pre ? maxSamples - triggerConfig.pre : 0;
+}
+
+void printTriggerConfig() {
+    if (triggerConfig.type == TRIG_OFF) {
+        console.print("Trigger: off");
+    } else if (triggerConfig.type == TRIG_WINDOW) {
+        console.printf("Trigger: leaves window %.4f - %.4f V", sampleToVolts(triggerConfig.level), sampleToVolts(triggerConfig.high));
+    } else {
+        console.printf("Trigger: %s %.4f V", triggerName(triggerConfig.type), sampleToVolts(triggerConfig.level));
+    }
+    console.printf(" (%u pre, %u post samples%s)\n", (unsigned)triggerConfig.pre, (unsigned)triggerPostSamples(),
+                  triggerConfig.post == 0 ? ", post fills the arena" : "");
+}
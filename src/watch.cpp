@@ -0,0 +1,160 @@
+// =============================
+// Inline Event Detection ('watch')
+// =============================
+
+#include "watch.h"
+#include "console.h"
+#include "frame.h"
+#include "stream.h"
+
+WatchConfig watchConfig = { false, 0, 0, false, 0, WATCH_DEFAULT_DROPOUT_MS, WATCH_DEFAULT_HYSTERESIS };
+
+static SpscRing<WatchEvent, WATCH_QUEUE_SIZE> events; // Detectors -> loop()
+static WatchConfig active;              // Settings of the current capture
+static bool enabled = false;
+static bool started = false;            // First sample seen
+static uint32_t expectedIndex = 0;
+static bool above = false;              // Level detector state
+static int32_t baseline = 0;            // Spike detector moving average (sample << 8)
+static int32_t spikeRearm = 0;          // Deviation a spike must fall back under
+static bool inSpike = false;
+static bool low = false;                // Below the dropout level (not yet back above it + hysteresis)
+static bool inDropout = false;          // ... for at least dropoutSamples
+static uint32_t lowIndex = 0;           // Where the current low stretch started
+static uint32_t lowMicros = 0;
+static uint32_t dropoutSamples = 1;
+static volatile uint32_t counts[WATCH_EVENT_TYPES];
+
+const char *watchEventName(uint8_t type) {
+    switch (type) {
+        case WATCH_RISE:    return "rise";
+        case WATCH_FALL:    return "fall";
+        case WATCH_SPIKE:   return "spike";
+        case WATCH_DROPOUT: return "dropout";
+        case WATCH_RESTORE: return "restore";
+        case WATCH_GAP:     return "gap";
+        default:            return "?";
+    }
+}
+
+bool watchEnabled() {
+    return watchConfig.levelOn || watchConfig.spike > 0 || watchConfig.dropoutOn;
+}
+
+void watchBegin(int rateHz) {
+    active = watchConfig;
+    enabled = watchEnabled();
+    started = false;
+    inSpike = false;
+    low = false;
+    inDropout = false;
+    int32_t h = active.hysteresis;
+    spikeRearm = active.spike > 2 * h ? active.spike - h : active.spike / 2;
+    dropoutSamples = max(1UL, (unsigned long)((uint64_t)active.dropoutMs * rateHz / 1000));
+    for (int i = 0; i < WATCH_EVENT_TYPES; i++) counts[i] = 0;
+    events.clear();
+    events.resetDropped();
+}
+
+static void emit(uint8_t type, uint32_t index, uint32_t micros, uint32_t value) {
+    WatchEvent event = { index, micros, (sample_t)(value > 65535 ? 65535 : value), type };
+    counts[type] = counts[type] + 1;
+    events.push(event); // A full queue drops the event (counted by the ring)
+}
+
+void watchSample(const LiveSample &live) {
+    if (!enabled) return;
+    int32_t s = live.sample;
+    int32_t h = active.hysteresis;
+    if (!started) {
+        // The first sample sets the detectors' state without reporting anything
+        started = true;
+        above = s > active.level;
+        baseline = s << 8;
+        expectedIndex = live.index + 1;
+        return;
+    }
+    if (live.index != expectedIndex) emit(WATCH_GAP, expectedIndex, live.micros, live.index - expectedIndex);
+    expectedIndex = live.index + 1;
+    if (active.levelOn) {
+        if (!above && s > active.level + h) {
+            above = true;
+            emit(WATCH_RISE, live.index, live.micros, s);
+        } else if (above && s < active.level - h) {
+            above = false;
+            emit(WATCH_FALL, live.index, live.micros, s);
+        }
+    }
+    if (active.spike > 0) {
+        int32_t deviation = (s << 8) - baseline;
+        int32_t size = abs(deviation) >> 8;
+        if (!inSpike && size > active.spike) {
+            inSpike = true;
+            emit(WATCH_SPIKE, live.index, live.micros, s);
+        } else if (inSpike && size < spikeRearm) {
+            inSpike = false;
+        }
+        baseline += deviation >> WATCH_BASELINE_SHIFT;
+    }
+    if (active.dropoutOn) {
+        if (s < active.dropout) {
+            if (!low) {
+                low = true;
+                lowIndex = live.index;
+                lowMicros = live.micros;
+            }
+            if (!inDropout && live.index - lowIndex + 1 >= dropoutSamples) {
+                inDropout = true;
+                emit(WATCH_DROPOUT, lowIndex, lowMicros, s);
+            }
+        } else if (low && s > active.dropout + h) {
+            if (inDropout) emit(WATCH_RESTORE, live.index, live.micros, s);
+            low = false;
+            inDropout = false;
+        }
+    }
+}
+
+void watchService() {
+    WatchEvent event;
+    while (events.pop(event)) {
+        if (streamActive()) {
+            // Keep the serial stream binary; decode_stream.py prints these
+            uint8_t payload[11];
+            uint8_t *p = payload;
+            p = putU32(p, event.index);
+            p = putU32(p, event.micros);
+            p = putU8(p, event.type);
+            putU16(p, event.value);
+            sendFrame(FRAME_EVENT, payload, sizeof(payload));
+        } else if (event.type == WATCH_GAP) {
+            console.printf("EVENT,gap,%u,%.6f,%u\n", (unsigned)event.index, event.micros / 1e6, (unsigned)event.value);
+        } else {
+            console.printf("EVENT,%s,%u,%.6f,%.4f\n", watchEventName(event.type), (unsigned)event.index, event.micros / 1e6,
+                           sampleToVolts(event.value));
+        }
+    }
+}
+
+uint32_t watchEventCount(uint8_t type) {
+    return type < WATCH_EVENT_TYPES ? counts[type] : 0;
+}
+
+uint32_t watchLostEvents() {
+    return events.dropped();
+}
+
+void printWatchConfig() {
+    if (!watchEnabled()) {
+        console.println("Watch: off");
+        return;
+    }
+    console.print("Watch:");
+    if (watchConfig.levelOn) console.printf(" level %.4f V,", sampleToVolts(watchConfig.level));
+    if (watchConfig.spike > 0) console.printf(" spikes over %.4f V,", sampleToVolts(watchConfig.spike));
+    if (watchConfig.dropoutOn) console.printf(" dropouts below %.4f V for %u ms,", sampleToVolts(watchConfig.dropout), watchConfig.dropoutMs);
+    console.printf(" hysteresis %.4f V\n", sampleToVolts(watchConfig.hysteresis));
+    console.print("Watch events:");
+    for (int i = 0; i < WATCH_EVENT_TYPES; i++) console.printf(" %u %s%s", (unsigned)counts[i], watchEventName(i), i + 1 < WATCH_EVENT_TYPES ? "," : "");
+    console.printf(" (%u lost)\n", (unsigned)watchLostEvents());
+}
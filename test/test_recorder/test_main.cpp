@@ -0,0 +1,322 @@
+// =============================
+// Recorder Test Suite (runs on the ESP32)
+// =============================
+// pio test -e esp32doit-devkit-v1
+//
+// The firmware sources are built in (test_build_src = yes); main.cpp leaves
+// out its setup() and loop() under PIO_UNIT_TESTING. The codec, filter and
+// calibration tests need nothing attached. The loopback test needs GPIO25
+// (DAC1) wired to GPIO36 and is ignored otherwise.
+// =============================
+
+#include <Arduino.h>
+#include <unity.h>
+#include <driver/dac.h>
+#include "recorder.h"
+#include "sampler.h"
+#include "sample_arena.h"
+#include "calibration.h"
+#include "compress.h"
+#include "decimator.h"
+#include "interpolator.h"
+#include "spectrum.h"
+#include "watch.h"
+#include "envelope.h"
+#include "frame.h"
+#include "timing.h"
+#include "trigger.h"
+#include "spsc_ring.h"
+#include "oversampling.h"
+#include "bench.h"
+
+#define TEST_ARENA_KB 64
+
+void setUp() {}
+void tearDown() {}
+
+// CRC-16/CCITT-FALSE check value, shared with tools/decode_stream.py
+static void test_crc16_check_value() {
+    const char *text = "123456789";
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Update(0xFFFF, (const uint8_t *)text, strlen(text)));
+}
+
+// Test signal with every kind of token: a slow wave (small deltas), flat
+// stretches (runs), random jumps, and a final flat stretch longer than
+// COMPRESS_MAX_RUN that has to be split across run tokens
+static sample_t testPattern(int i, uint32_t &seed, sample_t previous) {
+    seed = seed * 1103515245 + 12345;
+    if (i >= 30000) return previous;
+    if (i % 1000 == 0) return (sample_t)((seed >> 16) % SAMPLE_FULL_SCALE);
+    if (i % 20000 >= 10000) return previous;
+    return (sample_t)(16500 + 3000 * sin(i * 0.01));
+}
+
+static void test_compress_round_trip() {
+    const int count = 30000 + COMPRESS_MAX_RUN + 2000;
+    sampleCount = 0;
+    compressBegin();
+    uint32_t seed = 1;
+    sample_t expected = 0;
+    for (int i = 0; i < count; i++) {
+        expected = testPattern(i, seed, expected);
+        TEST_ASSERT_TRUE(compressAppend(expected));
+        sampleCount = sampleCount + 1;
+    }
+    compressFlush();
+    TEST_ASSERT_LESS_THAN(count * sizeof(sample_t), compressedBytes());
+    // Regenerate the same sequence and compare it with what the reader decodes
+    seed = 1;
+    expected = 0;
+    SampleReader reader;
+    reader.begin();
+    for (int i = 0; i < count; i++) {
+        expected = testPattern(i, seed, expected);
+        TEST_ASSERT_EQUAL_UINT16(expected, reader.next());
+    }
+    sampleCount = 0;
+    storageCompressed = false;
+}
+
+static void test_calibration_lut_monotonic() {
+    buildCalibrationLut();
+    for (int code = 1; code <= ADC_MAX_CODE; code++) {
+        TEST_ASSERT_TRUE(calLut[code] >= calLut[code - 1]);
+    }
+    // Fractional codes interpolate between neighbouring entries
+    uint32_t raw = (2000 << RAW_FRAC_BITS) | (1 << (RAW_FRAC_BITS - 1));
+    TEST_ASSERT_UINT16_WITHIN(1, (calLut[2000] + calLut[2001]) / 2, rawToSample(raw));
+}
+
+// A constant input must come out unchanged through every filter
+static void test_decimator_dc_gain() {
+    static uint16_t raw[256];
+    static uint32_t out[256];
+    for (int i = 0; i < 256; i++) raw[i] = 1234;
+    const FilterType types[] = { FILTER_BOX, FILTER_CIC, FILTER_FIR };
+    for (FilterType type : types) {
+        decimatorBegin(type, 8);
+        size_t produced = 0;
+        for (int block = 0; block < 8; block++) produced = decimatorProcess(0, raw, 256, out, 256); // Settle
+        TEST_ASSERT_EQUAL(256 / 8, produced);
+        TEST_ASSERT_UINT32_WITHIN(1, 1234u << RAW_FRAC_BITS, out[produced - 1]);
+    }
+}
+
+static void test_interpolator_interval_count_and_level() {
+    static uint16_t out[48];
+    const InterpMode modes[] = { INTERP_HOLD, INTERP_LINEAR, INTERP_FIR };
+    for (InterpMode mode : modes) {
+        InterpState state;
+        interpBegin(state, mode, DITHER_OFF, 1);
+        int intervals = 0;
+        for (int i = 0; i < 20 + interpDelay(state); i++) {
+            if (!interpPush(state, 16500)) continue; // 1.65 V
+            interpRender(state, 0, (uint32_t)(0x100000000ULL / 48), 48, out, 1);
+            intervals++;
+        }
+        TEST_ASSERT_EQUAL(20, intervals); // One interval per sample, whatever the filter delay
+        for (int i = 0; i < 48; i++) TEST_ASSERT_INT_WITHIN(1, 127, out[i] >> 8);
+    }
+}
+
+// 1 V tone at 125 Hz (exactly bin 512) with a 2% third harmonic, sampled at 1 kHz
+static void test_spectrum_tone_and_thd() {
+    const int points = 4096;
+    int savedRate = recordedRate;
+    bool savedCompressed = storageCompressed;
+    int savedCount = sampleCount;
+    recordedRate = 1000;
+    storageCompressed = false;
+    for (int i = 0; i < points; i++) {
+        float t = i * 2 * PI * 125 / 1000;
+        voltageBuffer[i] = (sample_t)lroundf((1.65 + sin(t) + 0.02 * sin(3 * t)) * SAMPLE_UNITS_PER_VOLT);
+    }
+    sampleCount = points;
+    SpectrumResult result;
+    TEST_ASSERT_TRUE(spectrumAnalyze(0, points, 0, WINDOW_BLACKMAN, result));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.65, result.dc);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 125.0, result.peaks[0].frequency);
+    TEST_ASSERT_FLOAT_WITHIN(0.005, 0.7071, result.peaks[0].rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 2.0, result.thdPercent);
+    TEST_ASSERT_LESS_THAN_FLOAT(-100.0, result.noiseFloorDb); // Only the 0.1 mV rounding is left
+    sampleCount = savedCount;
+    storageCompressed = savedCompressed;
+    recordedRate = savedRate;
+}
+
+static void test_watch_hysteresis_and_events() {
+    WatchConfig saved = watchConfig;
+    watchConfig = { true, 15000, 5000, true, 1000, 10, 100 }; // Level 1.5 V, spikes over 0.5 V, dropouts below 0.1 V
+    watchBegin(1000);
+    uint32_t index = 0;
+    auto feed = [&](sample_t sample, int count) {
+        for (int i = 0; i < count; i++, index++) watchSample({ index, index * 1000, sample });
+    };
+    feed(14000, 50);
+    for (int i = 0; i < 20; i++) feed(i % 2 ? 15050 : 14950, 1); // Chatter inside the hysteresis band
+    TEST_ASSERT_EQUAL_UINT32(0, watchEventCount(WATCH_RISE));
+    feed(16000, 50);
+    feed(14000, 50);
+    TEST_ASSERT_EQUAL_UINT32(1, watchEventCount(WATCH_RISE));
+    TEST_ASSERT_EQUAL_UINT32(1, watchEventCount(WATCH_FALL));
+    feed(20000, 1); // One-sample spike
+    feed(14000, 50);
+    feed(0, 9);     // Too short for a dropout
+    feed(14000, 50);
+    feed(0, 20);
+    feed(14000, 10);
+    TEST_ASSERT_EQUAL_UINT32(1, watchEventCount(WATCH_DROPOUT));
+    TEST_ASSERT_EQUAL_UINT32(1, watchEventCount(WATCH_RESTORE));
+    index += 5;     // Lost samples
+    feed(14000, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, watchEventCount(WATCH_GAP));
+    TEST_ASSERT_TRUE(watchEventCount(WATCH_SPIKE) >= 1);
+    watchConfig = saved;
+    watchBegin(1000); // Drop the queued events
+}
+
+// Twice the frames the pyramid was sized for, so it has to regrow once
+static void test_envelope_range_matches_scan() {
+    static sample_t frames[4096];
+    for (int i = 0; i < 4096; i++) frames[i] = (sample_t)((i * 7919) % 30011); // Scrambled
+    envelopeBegin(2048, 1);
+    for (int i = 0; i < 4096; i++) envelopeAdd(&frames[i]);
+    uint32_t block = envelopeBlockFrames();
+    TEST_ASSERT_EQUAL_UINT32(4096, envelopeFrames());
+    const uint32_t ranges[][2] = { { 0, 4096 }, { 0, 1 }, { 3, 17 }, { 100, 2500 }, { 1023, 1 }, { 4000, 96 } };
+    for (const auto &range : ranges) {
+        uint32_t first = range[0] / block * block; // Whole blocks only
+        uint32_t count = min(max(range[1] / block, 1U) * block, 4096 - first);
+        sample_t lo = 0xFFFF, hi = 0;
+        for (uint32_t i = first; i < first + count; i++) {
+            lo = min(lo, frames[i]);
+            hi = max(hi, frames[i]);
+        }
+        EnvelopeEntry entry = envelopeRange(first, count, 0);
+        TEST_ASSERT_EQUAL_UINT16(lo, entry.min);
+        TEST_ASSERT_EQUAL_UINT16(hi, entry.max);
+    }
+}
+
+static void test_spsc_ring_order_and_overflow() {
+    static SpscRing<uint32_t, 8> ring;
+    ring.clear();
+    for (uint32_t i = 0; i < 8; i++) TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_FALSE(ring.push(99));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.dropped());
+    uint32_t value;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(ring.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+    TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+static void test_trigger_conditions() {
+    TriggerConfig config = {};
+    config.level = 15000;
+    config.high = 20000;
+    config.type = TRIG_RISING;
+    TEST_ASSERT_TRUE(triggerFires(config, 14999, 15000));
+    TEST_ASSERT_FALSE(triggerFires(config, 15000, 16000));
+    config.type = TRIG_FALLING;
+    TEST_ASSERT_TRUE(triggerFires(config, 15001, 15000));
+    config.type = TRIG_WINDOW;
+    TEST_ASSERT_TRUE(triggerFires(config, 17000, 21000));
+    TEST_ASSERT_FALSE(triggerFires(config, 21000, 22000));
+}
+
+// 1 kHz with light oversampling must keep every deadline
+static void test_sampler_keeps_schedule() {
+    adcSamples = 8;
+    acqMode = ACQ_PRECISE;
+    sampleCount = 0;
+    storageCompressed = false;
+    recording = true;
+    samplerStart(1000);
+    delay(500);
+    samplerStop();
+    recording = false;
+    TimingStats timing;
+    timingGet(timing);
+    TEST_ASSERT_INT_WITHIN(5, 500, frameCount());
+    TEST_ASSERT_EQUAL_UINT32(0, samplerMissedTicks());
+    TEST_ASSERT_EQUAL_UINT32(0, timing.deadlineMisses);
+    TEST_ASSERT_LESS_THAN_INT32(200, timing.worstLate);
+    // Stamped times stay within a period of the nominal schedule
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 400.0, sampleTimeMs(400));
+    sampleCount = 0;
+    adcSamples = BASELINE_ADC_SAMPLES;
+}
+
+// 'bench' after a capture leaves its statistics, timestamps and 'samples auto' choice alone
+static void test_bench_keeps_recording() {
+    bool savedAuto = autoOversampling;
+    autoOversampling = true;
+    acqMode = ACQ_PRECISE;
+    sampleCount = 0;
+    storageCompressed = false;
+    recording = true;
+    samplerStart(1000);
+    delay(300);
+    samplerStop();
+    recording = false;
+    RunningStats before;
+    samplerGetStats(before);
+    float stampedMs = sampleTimeMs(200);
+    int samples = adcSamples;
+    runBenchmarks();
+    RunningStats after;
+    samplerGetStats(after);
+    TEST_ASSERT_EQUAL_UINT32(before.count, after.count);
+    TEST_ASSERT_EQUAL_UINT16(before.minSample, after.minSample);
+    TEST_ASSERT_EQUAL_UINT16(before.maxSample, after.maxSample);
+    TEST_ASSERT_TRUE(before.sum == after.sum);
+    TEST_ASSERT_EQUAL_FLOAT(stampedMs, sampleTimeMs(200));
+    TEST_ASSERT_EQUAL(samples, adcSamples);
+    sampleCount = 0;
+    autoOversampling = savedAuto;
+    adcSamples = BASELINE_ADC_SAMPLES;
+}
+
+// DAC1 -> ADC loopback within 100 mV at mid scale (GPIO25 wired to GPIO36)
+static void test_loopback_error() {
+    dac_output_enable(DAC_CHANNEL_1);
+    dac_output_voltage(DAC_CHANNEL_1, 255);
+    delay(5);
+    if (readVoltageHighPrecision() < 1.0) {
+        dac_output_voltage(DAC_CHANNEL_1, 0);
+        TEST_IGNORE_MESSAGE("GPIO25 is not wired to GPIO36");
+    }
+    dac_output_voltage(DAC_CHANNEL_1, 128);
+    delay(5);
+    float volts = readVoltageHighPrecision();
+    dac_output_voltage(DAC_CHANNEL_1, 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 128 * 3.3 / 255, volts);
+}
+
+void setup() {
+    delay(2000); // Give the test runner time to open the port
+    setupADC();
+    buildCalibrationLut();
+    setupDAC();
+    setupSampler();
+    allocateSampleArena(TEST_ARENA_KB);
+    UNITY_BEGIN();
+    RUN_TEST(test_crc16_check_value);
+    RUN_TEST(test_compress_round_trip);
+    RUN_TEST(test_calibration_lut_monotonic);
+    RUN_TEST(test_decimator_dc_gain);
+    RUN_TEST(test_interpolator_interval_count_and_level);
+    RUN_TEST(test_spectrum_tone_and_thd);
+    RUN_TEST(test_watch_hysteresis_and_events);
+    RUN_TEST(test_envelope_range_matches_scan);
+    RUN_TEST(test_spsc_ring_order_and_overflow);
+    RUN_TEST(test_trigger_conditions);
+    RUN_TEST(test_sampler_keeps_schedule);
+    RUN_TEST(test_bench_keeps_recording);
+    RUN_TEST(test_loopback_error);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Run the Voltage Recorder's on-device benchmarks and compare them with a baseline.
+
+The firmware's 'bench' command prints machine-readable lines (see include/bench.h):
+
+    BENCH,begin,<version>
+    BENCH,<metric>,<value>,<unit>      (or BENCH,<metric>,skipped,<reason>)
+    BENCH,end
+
+Usage:
+    python tools/bench.py --port /dev/ttyUSB0 --out bench-v1.2.0.json
+    python tools/bench.py --port /dev/ttyUSB0 --baseline bench-v1.1.2.json --tolerance 0.1
+
+With --baseline, every metric that got worse by more than the tolerance is
+listed and the exit status is 1, so the script can gate a release.
+"""
+
+import argparse
+import json
+import sys
+
+from decode_stream import read_line, send_command
+
+# Metrics where a larger value is an improvement; everything else should shrink
+HIGHER_IS_BETTER = ("max_rate", "export_encode")
+# Settings the run was made with, echoed for reference; never a regression
+CONFIG_ECHOES = ("samples", "channels", "export_link")  # export_link follows from the baud rate
+
+
+def run_bench(port, timeout=60.0):
+    """Send 'bench' and collect the results as {"version": ..., "metrics": {name: {value, unit}}}."""
+    port.reset_input_buffer()
+    send_command(port, "bench")
+    result = {"version": None, "metrics": {}}
+    while True:
+        line = read_line(port, timeout)
+        if line is None:
+            sys.exit("Timed out waiting for benchmark results")
+        if not line.startswith("BENCH,"):
+            print(line, file=sys.stderr)
+            continue
+        fields = line.split(",")
+        if fields[1] == "begin":
+            result["version"] = fields[2] if len(fields) > 2 else None
+        elif fields[1] == "end":
+            return result
+        elif len(fields) >= 4:
+            name, value, unit = fields[1], fields[2], fields[3]
+            if value == "skipped":
+                result["metrics"][name] = {"skipped": unit}
+            else:
+                result["metrics"][name] = {"value": float(value), "unit": unit}
+
+
+def regressions(current, baseline, tolerance):
+    """Metrics that moved the wrong way by more than `tolerance` (a fraction)."""
+    worse = []
+    for name, old in baseline["metrics"].items():
+        new = current["metrics"].get(name)
+        if name in CONFIG_ECHOES or new is None or "value" not in new or "value" not in old:
+            continue
+        before, after = old["value"], new["value"]
+        if name.endswith("_error"):
+            before, after = abs(before), abs(after)
+        if name in HIGHER_IS_BETTER:
+            bad = after < before * (1 - tolerance)
+        else:
+            bad = after > before * (1 + tolerance) and after - before > 1.0  # Ignore sub-unit noise
+        if bad:
+            worse.append((name, old["value"], new["value"], new["unit"]))
+    return worse
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Voltage Recorder benchmark runner")
+    parser.add_argument("--port", required=True, help="Serial port, e.g. /dev/ttyUSB0 or COM3")
+    parser.add_argument("--baud", type=int, default=115200, help="Current baud rate of the link")
+    parser.add_argument("--out", help="Write the results to this JSON file")
+    parser.add_argument("--baseline", help="Compare with results saved from an earlier release")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="Allowed change before a metric counts as a regression")
+    args = parser.parse_args()
+
+    import serial  # pyserial
+
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        result = run_bench(port)
+    for name, metric in result["metrics"].items():
+        if "value" in metric:
+            print(f"{name:24} {metric['value']:12.3f} {metric['unit']}")
+        else:
+            print(f"{name:24} {'skipped':>12} ({metric['skipped']})")
+    if args.out:
+        with open(args.out, "w") as out:
+            json.dump(result, out, indent=2)
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        worse = regressions(result, baseline, args.tolerance)
+        for name, before, after, unit in worse:
+            print(f"REGRESSION {name}: {before:.3f} -> {after:.3f} {unit}", file=sys.stderr)
+        if worse:
+            sys.exit(1)
+        print(f"No regressions against {baseline.get('version')}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,445 @@
+#!/usr/bin/env python3
+"""Host-side decoder for the Voltage Recorder's binary serial frames.
+
+Frame layout (little-endian), see include/frame.h:
+
+    0xA5 0x5A | type u8 | length u16 | payload | crc16 u16
+
+The CRC is CRC-16/CCITT-FALSE over type, length and payload. Text printed by
+the firmware between frames is passed through to stderr.
+
+Usage:
+    python tools/decode_stream.py --port /dev/ttyUSB0 stream --out capture.csv
+    python tools/decode_stream.py --port /dev/ttyUSB0 dump --out recording.csv
+    python tools/decode_stream.py --port /dev/ttyUSB0 --set-baud 921600 dump
+    python tools/decode_stream.py --port /dev/ttyUSB0 overview 2000 --out overview.csv
+    python tools/decode_stream.py --port /dev/ttyUSB0 range 50000 60000 --out zoom.csv
+    python tools/decode_stream.py collect --listen 9750 --out-dir captures
+
+`collect` receives UDP streams ('net stream <this-host> 9750' on each
+recorder): every datagram is one frame, and each source address gets its own
+CSV file.
+"""
+
+import argparse
+import os
+import socket
+import struct
+import sys
+import time
+
+SYNC = b"\xa5\x5a"
+
+FRAME_STREAM_START = 0x01
+FRAME_STREAM_DATA = 0x02
+FRAME_STREAM_END = 0x03
+FRAME_EVENT = 0x04
+FRAME_DUMP_HEADER = 0x10
+FRAME_DUMP_DATA = 0x11
+FRAME_DUMP_END = 0x12
+FRAME_OVERVIEW_HEADER = 0x20
+FRAME_OVERVIEW_DATA = 0x21
+FRAME_OVERVIEW_END = 0x22
+
+# GPIO of ADC1 channel 0..7 (src/channels.cpp)
+CHANNEL_GPIOS = [36, 37, 38, 39, 32, 33, 34, 35]
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matching crc16Update() in src/frame.cpp."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+class FrameReader:
+    """Pulls complete, CRC-checked frames out of a serial byte stream."""
+
+    def __init__(self, port, text_out=sys.stderr):
+        self.port = port
+        self.buffer = bytearray()
+        self.text_out = text_out
+        self.bad_frames = 0
+
+    def _fill(self):
+        chunk = self.port.read(self.port.in_waiting or 1)
+        self.buffer.extend(chunk)
+        return len(chunk) > 0
+
+    def read_frame(self, timeout=2.0):
+        """Return (type, payload) for the next valid frame, or None on timeout."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # Keep a trailing 0xA5 in case the sync word is split across reads
+                keep = 1 if self.buffer.endswith(SYNC[:1]) else 0
+                self._echo_text(self.buffer[:len(self.buffer) - keep])
+                del self.buffer[:len(self.buffer) - keep]
+                self._fill()
+                continue
+            self._echo_text(self.buffer[:start])
+            del self.buffer[:start]
+            if len(self.buffer) < 5:
+                self._fill()
+                continue
+            ftype = self.buffer[2]
+            (length,) = struct.unpack_from("<H", self.buffer, 3)
+            if length > 1024:
+                del self.buffer[:1]  # Not a real frame header; resync
+                continue
+            total = 5 + length + 2
+            if len(self.buffer) < total:
+                self._fill()
+                continue
+            (crc,) = struct.unpack_from("<H", self.buffer, 5 + length)
+            if crc16(self.buffer[2:5 + length]) != crc:
+                self.bad_frames += 1
+                del self.buffer[:1]
+                continue
+            payload = bytes(self.buffer[5:5 + length])
+            del self.buffer[:total]
+            return ftype, payload
+        return None
+
+    def _echo_text(self, data):
+        if data and self.text_out is not None:
+            self.text_out.write(data.decode("ascii", errors="replace"))
+            self.text_out.flush()
+
+
+def send_command(port, command):
+    port.write((command + "\n").encode("ascii"))
+    port.flush()
+
+
+def read_line(port, timeout):
+    """Read one text line (without the newline), or None on timeout."""
+    deadline = time.monotonic() + timeout
+    line = bytearray()
+    while time.monotonic() < deadline:
+        chunk = port.read(1)
+        if not chunk:
+            continue
+        if chunk == b"\n":
+            return line.decode("ascii", errors="replace").strip()
+        line.extend(chunk)
+    return None
+
+
+def negotiate_baud(port, new_baud):
+    """Run the device's 'baud' handshake; returns True once both sides run at new_baud."""
+    port.reset_input_buffer()
+    send_command(port, f"baud {new_baud}")
+    deadline = time.monotonic() + 2.0
+    while True:
+        line = read_line(port, max(0.0, deadline - time.monotonic()))
+        if line is None:
+            return False
+        if line.startswith(f"BAUD {new_baud} SWITCHING"):
+            break
+        if line.startswith("Invalid baud") or line.startswith("Stop recording"):
+            print(line, file=sys.stderr)
+            return False
+    port.baudrate = new_baud
+    time.sleep(0.05)  # Give the device time to reconfigure its UART
+    port.reset_input_buffer()
+    send_command(port, "ok")
+    line = read_line(port, 1.5)
+    while line is not None and not line.startswith("BAUD"):
+        line = read_line(port, 1.5)
+    return line == f"BAUD {new_baud} OK"
+
+
+EVENT_NAMES = ["rise", "fall", "spike", "dropout", "restore", "gap"]  # watch.h WatchEventType
+
+
+def format_event(payload, units_per_volt):
+    """EVENT,<type>,<index>,<time_s>,<value> line for a FRAME_EVENT payload (same as the device prints)."""
+    index, time_us, etype, value = struct.unpack_from("<IIBH", payload)
+    name = EVENT_NAMES[etype] if etype < len(EVENT_NAMES) else str(etype)
+    shown = str(value) if name == "gap" else f"{value / units_per_volt:.4f}"
+    return f"EVENT,{name},{index},{time_us / 1e6:.6f},{shown}"
+
+
+def cmd_stream(args, port):
+    reader = FrameReader(port)
+    send_command(port, "stream")
+    units_per_volt = 10000
+    sample_rate = None
+    received = 0
+    lost = 0
+    next_index = 0
+    ended = False
+    events = open(args.events, "w") if args.events else None
+    with open(args.out, "w") as out:
+        out.write("index,time_s,voltage_v\n")
+        started = time.monotonic()
+        try:
+            while not ended:
+                if args.duration and time.monotonic() - started >= args.duration:
+                    break
+                frame = reader.read_frame()
+                if frame is None:
+                    continue
+                ftype, payload = frame
+                if ftype == FRAME_STREAM_START:
+                    version, units_per_volt, sample_rate, adc_samples, mode = struct.unpack_from("<BHIHB", payload)
+                    print(f"Stream v{version}: {sample_rate} Hz, {adc_samples} ADC samples, mode {mode}", file=sys.stderr)
+                elif ftype == FRAME_STREAM_DATA:
+                    seq, first_index, first_time_us, count = struct.unpack_from("<HIIH", payload)
+                    samples = struct.unpack_from(f"<{count}H", payload, 12)
+                    if first_index != next_index:
+                        lost += first_index - next_index
+                    for i, raw in enumerate(samples):
+                        index = first_index + i
+                        t = index / sample_rate if sample_rate else first_time_us / 1e6
+                        out.write(f"{index},{t:.6f},{raw / units_per_volt:.4f}\n")
+                    next_index = first_index + count
+                    received += count
+                elif ftype == FRAME_EVENT:
+                    line = format_event(payload, units_per_volt)
+                    print(line, file=sys.stderr)
+                    if events:
+                        events.write(line + "\n")
+                        events.flush()
+                elif ftype == FRAME_STREAM_END:
+                    sent, dropped = struct.unpack_from("<II", payload)
+                    print(f"Device sent {sent} samples, dropped {dropped}", file=sys.stderr)
+                    ended = True
+        except KeyboardInterrupt:
+            pass
+        if not ended:
+            send_command(port, "stop")
+            # Wait for the end frame so the device is back in command mode
+            frame = reader.read_frame()
+            while frame is not None and frame[0] != FRAME_STREAM_END:
+                frame = reader.read_frame()
+    if events:
+        events.close()
+    print(f"Received {received} samples ({lost} lost, {reader.bad_frames} bad frames) -> {args.out}", file=sys.stderr)
+
+
+def parse_frame(datagram):
+    """Return (type, payload) for a datagram holding one valid frame, or None."""
+    if len(datagram) < 7 or datagram[:2] != SYNC:
+        return None
+    (length,) = struct.unpack_from("<H", datagram, 3)
+    if len(datagram) != 7 + length:
+        return None
+    (crc,) = struct.unpack_from("<H", datagram, 5 + length)
+    if crc16(datagram[2:5 + length]) != crc:
+        return None
+    return datagram[2], datagram[5:5 + length]
+
+
+def cmd_collect(args):
+    """Write the UDP streams of any number of recorders to one CSV each."""
+    os.makedirs(args.out_dir, exist_ok=True)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+    sock.bind(("", args.listen))
+    sock.settimeout(0.5)
+    streams = {}  # Source address -> state
+    print(f"Listening on UDP port {args.listen}, Ctrl+C to stop", file=sys.stderr)
+    started = time.monotonic()
+    try:
+        while not args.duration or time.monotonic() - started < args.duration:
+            try:
+                datagram, (host, _) = sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            frame = parse_frame(datagram)
+            state = streams.get(host)
+            if state is None:
+                path = os.path.join(args.out_dir, f"{host.replace('.', '_')}.csv")
+                state = dict(out=open(path, "w"), rate=None, units=10000, next_index=0, received=0, lost=0, bad=0)
+                state["out"].write("index,time_s,voltage_v\n")
+                streams[host] = state
+                print(f"{host}: new stream -> {path}", file=sys.stderr)
+            if frame is None:
+                state["bad"] += 1
+                continue
+            ftype, payload = frame
+            if ftype == FRAME_STREAM_START:
+                if state["rate"] is None:
+                    version, state["units"], state["rate"], adc_samples, mode = struct.unpack_from("<BHIHB", payload)
+                    print(f"{host}: {state['rate']} Hz, {adc_samples} ADC samples, mode {mode}", file=sys.stderr)
+            elif ftype == FRAME_STREAM_DATA:
+                seq, first_index, first_time_us, count = struct.unpack_from("<HIIH", payload)
+                if first_index < state["next_index"]:
+                    continue  # Duplicate or reordered packet
+                state["lost"] += first_index - state["next_index"]
+                for i, raw in enumerate(struct.unpack_from(f"<{count}H", payload, 12)):
+                    index = first_index + i
+                    t = index / state["rate"] if state["rate"] else first_time_us / 1e6
+                    state["out"].write(f"{index},{t:.6f},{raw / state['units']:.4f}\n")
+                state["next_index"] = first_index + count
+                state["received"] += count
+            elif ftype == FRAME_STREAM_END:
+                sent, dropped = struct.unpack_from("<II", payload)
+                print(f"{host}: stream ended, device sent {sent} samples, dropped {dropped}", file=sys.stderr)
+    except KeyboardInterrupt:
+        pass
+    for host, state in streams.items():
+        state["out"].close()
+        print(f"{host}: received {state['received']} samples ({state['lost']} lost, {state['bad']} bad packets)",
+              file=sys.stderr)
+
+
+def cmd_dump(args, port):
+    reader = FrameReader(port)
+    started = time.monotonic()
+    send_command(port, f"range {args.start} {args.end}" if args.command == "range" else "dump")
+    header = None
+    samples = []
+    data_crc = 0xFFFF
+    while True:
+        frame = reader.read_frame(timeout=5.0)
+        if frame is None:
+            sys.exit("Timed out waiting for dump frames")
+        ftype, payload = frame
+        if ftype == FRAME_DUMP_HEADER:
+            version, units_per_volt, sample_rate, count, offset, adc_samples, mode = struct.unpack_from("<BHIIHHB", payload)
+            channels, mask = struct.unpack_from("<BB", payload, 16) if version >= 2 else (1, 1)
+            (first_frame,) = struct.unpack_from("<I", payload, 18) if version >= 3 else (0,)
+            gpios = [gpio for bit, gpio in enumerate(CHANNEL_GPIOS) if mask & (1 << bit)]
+            header = dict(version=version, units_per_volt=units_per_volt, sample_rate=sample_rate,
+                          count=count, offset=offset, adc_samples=adc_samples, mode=mode,
+                          channels=channels, gpios=gpios, first_frame=first_frame)
+            print(f"Dump v{version}: {count} samples from frame {first_frame} at {sample_rate} Hz, "
+                  f"offset {offset / units_per_volt:.4f} V, {adc_samples} ADC samples, "
+                  f"channels {', '.join(f'GPIO{g}' for g in gpios)}", file=sys.stderr)
+        elif ftype == FRAME_DUMP_DATA and header is not None:
+            first_index, count = struct.unpack_from("<IH", payload)
+            if first_index != len(samples):
+                sys.exit(f"Missing data: expected sample {len(samples)}, got {first_index}")
+            data_crc = crc16(payload[6:], data_crc)
+            samples.extend(struct.unpack_from(f"<{count}H", payload, 6))
+        elif ftype == FRAME_DUMP_END and header is not None:
+            count, crc = struct.unpack_from("<IH", payload)
+            if count != len(samples) or crc != data_crc:
+                sys.exit(f"Dump corrupted: {len(samples)}/{count} samples, crc {data_crc:04x} != {crc:04x}")
+            break
+    elapsed = time.monotonic() - started
+    rate = header["sample_rate"]
+    channels = header["channels"]
+    units = header["units_per_volt"]
+    first_frame = header["first_frame"]
+    with open(args.out, "w") as out:
+        # Samples are interleaved frames: one column per channel
+        if channels == 1:
+            out.write("index,time_s,voltage_v\n")
+        else:
+            out.write("index,time_s," + ",".join(f"gpio{g}_v" for g in header["gpios"]) + "\n")
+        for index in range(len(samples) // channels):
+            frame = samples[index * channels:(index + 1) * channels]
+            frame_index = first_frame + index
+            out.write(f"{frame_index},{frame_index / rate:.6f}," + ",".join(f"{raw / units:.4f}" for raw in frame) + "\n")
+    print(f"Received {len(samples)} samples in {elapsed:.2f} s "
+          f"({2 * len(samples) / elapsed / 1024:.1f} KB/s) -> {args.out}", file=sys.stderr)
+
+
+def cmd_overview(args, port):
+    reader = FrameReader(port)
+    send_command(port, f"overview {args.points}")
+    header = None
+    points = []
+    while True:
+        frame = reader.read_frame(timeout=5.0)
+        if frame is None:
+            sys.exit("Timed out waiting for overview frames")
+        ftype, payload = frame
+        if ftype == FRAME_OVERVIEW_HEADER:
+            version, units, rate, frames, count, channels, mask, block = struct.unpack_from("<BHIIHBBI", payload)
+            gpios = [gpio for bit, gpio in enumerate(CHANNEL_GPIOS) if mask & (1 << bit)]
+            header = dict(units=units, rate=rate, frames=frames, count=count, channels=channels, gpios=gpios)
+            print(f"Overview v{version}: {frames} frames at {rate} Hz in {count} points "
+                  f"({f'{block}-frame blocks' if block else 'scanned'})", file=sys.stderr)
+        elif ftype == FRAME_OVERVIEW_DATA and header is not None:
+            first_point, count = struct.unpack_from("<HH", payload)
+            if first_point != len(points):
+                sys.exit(f"Missing data: expected point {len(points)}, got {first_point}")
+            offset = 4
+            for _ in range(count):
+                (first_frame,) = struct.unpack_from("<I", payload, offset)
+                ranges = struct.unpack_from(f"<{2 * header['channels']}H", payload, offset + 4)
+                points.append((first_frame, ranges))
+                offset += 4 + 4 * header["channels"]
+        elif ftype == FRAME_OVERVIEW_END and header is not None:
+            break
+    rate = header["rate"]
+    units = header["units"]
+    with open(args.out, "w") as out:
+        # One row per point: the frames it covers and min/max of each channel over them
+        names = ["voltage"] if header["channels"] == 1 else [f"gpio{g}" for g in header["gpios"]]
+        out.write("first_frame,frames,time_s," + ",".join(f"{n}_min_v,{n}_max_v" for n in names) + "\n")
+        for i, (first_frame, ranges) in enumerate(points):
+            end = points[i + 1][0] if i + 1 < len(points) else header["frames"]
+            out.write(f"{first_frame},{end - first_frame},{first_frame / rate:.6f}," +
+                      ",".join(f"{raw / units:.4f}" for raw in ranges) + "\n")
+    print(f"Received {len(points)} points -> {args.out}", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Voltage Recorder binary frame decoder")
+    parser.add_argument("--port", help="Serial port, e.g. /dev/ttyUSB0 or COM3 (not needed for collect)")
+    parser.add_argument("--baud", type=int, default=115200, help="Current baud rate of the link")
+    parser.add_argument("--set-baud", type=int, default=0,
+                        help="Negotiate this baud rate before running the command (e.g. 921600)")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p_stream = sub.add_parser("stream", help="Start streaming and write samples to CSV")
+    p_stream.add_argument("--out", default="stream.csv", help="Output CSV file")
+    p_stream.add_argument("--duration", type=float, default=0, help="Stop after this many seconds (0 = until Ctrl+C)")
+    p_stream.add_argument("--events", help="Also write 'watch' events to this file")
+
+    p_dump = sub.add_parser("dump", help="Export the recorded buffer to CSV")
+    p_dump.add_argument("--out", default="recording.csv", help="Output CSV file")
+
+    p_overview = sub.add_parser("overview", help="Min/max envelope of the recording to CSV")
+    p_overview.add_argument("points", type=int, help="Number of points (1-10000)")
+    p_overview.add_argument("--out", default="overview.csv", help="Output CSV file")
+
+    p_range = sub.add_parser("range", help="Export frames start..end-1 of the recording to CSV")
+    p_range.add_argument("start", type=int, help="First frame")
+    p_range.add_argument("end", type=int, help="Frame after the last one")
+    p_range.add_argument("--out", default="range.csv", help="Output CSV file")
+
+    p_collect = sub.add_parser("collect", help="Receive UDP streams from recorders ('net stream') into CSV files")
+    p_collect.add_argument("--listen", type=int, default=9750, help="UDP port to listen on")
+    p_collect.add_argument("--out-dir", default="captures", help="Directory for the per-recorder CSV files")
+    p_collect.add_argument("--duration", type=float, default=0, help="Stop after this many seconds (0 = until Ctrl+C)")
+
+    args = parser.parse_args()
+    if args.command == "collect":
+        cmd_collect(args)
+        return
+    if not args.port:
+        parser.error("--port is required for stream, dump, overview and range")
+
+    import serial  # pyserial
+
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        if args.set_baud and args.set_baud != args.baud:
+            if negotiate_baud(port, args.set_baud):
+                print(f"Link running at {args.set_baud} baud", file=sys.stderr)
+            else:
+                # The device falls back on its own after its confirmation timeout
+                port.baudrate = args.baud
+                time.sleep(2.5)
+                port.reset_input_buffer()
+                print(f"Baud change failed, staying at {args.baud}", file=sys.stderr)
+        if args.command == "stream":
+            cmd_stream(args, port)
+        elif args.command in ("dump", "range"):
+            cmd_dump(args, port)
+        elif args.command == "overview":
+            cmd_overview(args, port)
+
+
+if __name__ == "__main__":
+    main()